@@ -0,0 +1,225 @@
+#pragma once
+
+#include <stdint.h>
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <common_robotics_utilities/simple_rrt_planner.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Forward propagation function that is also given the global index of the
+/// sample being propagated (i.e. the number of samples drawn before it), which
+/// identifies the expansion independently of which thread performs it.
+template<typename StateType, typename SampleType=StateType>
+using IndexedRRTForwardPropagationFunction
+    = std::function<common_robotics_utilities::simple_rrt_planner
+        ::ForwardPropagation<StateType>(
+            const StateType&, const SampleType&, const int64_t)>;
+
+/// Batched variant of simple_rrt_planner::RRTPlanMultiPath. Each iteration
+/// draws batch_size samples and finds their nearest neighbors serially, then
+/// runs the forward propagations for the whole batch concurrently, since
+/// propagation (i.e. particle simulation) dominates planning time. Propagated
+/// states are merged into the tree in sample order, and the state added
+/// callback, goal check, and goal reached callback are all called serially, so
+/// the structure of the tree does not depend on which propagation finished
+/// first. The callbacks may be empty.
+///
+/// forward_propagation_fn is called from up to num_threads OpenMP threads at
+/// once, so it (and anything it uses) must be safe to call concurrently, e.g.
+/// by only using instances owned by the calling thread. Nearest neighbors for a
+/// batch are all found in the tree as it was before the batch, so with a batch
+/// size of 1 this behaves exactly like RRTPlanMultiPath. Since samples are
+/// drawn serially, the sample index passed to forward_propagation_fn is
+/// deterministic for a given sampling function. Propagated states are moved
+/// into the tree, so StateType must be default constructible.
+template<typename StateType, typename SampleType=StateType,
+         typename Container=std::vector<StateType>>
+inline common_robotics_utilities::simple_rrt_planner
+    ::MultipleSolutionPlanningResults<StateType, Container>
+BatchedRRTPlanMultiPath(
+    common_robotics_utilities::simple_rrt_planner::PlanningTree<StateType>&
+        tree,
+    const common_robotics_utilities::simple_rrt_planner
+        ::SamplingFunction<SampleType>& sampling_fn,
+    const common_robotics_utilities::simple_rrt_planner
+        ::RRTNearestNeighborFunction<StateType, SampleType>&
+            nearest_neighbor_fn,
+    const IndexedRRTForwardPropagationFunction<StateType, SampleType>&
+        forward_propagation_fn,
+    const common_robotics_utilities::simple_rrt_planner
+        ::RRTStateAddedCallbackFunction<StateType>& state_added_callback,
+    const common_robotics_utilities::simple_rrt_planner
+        ::CheckGoalReachedFunction<StateType>& goal_reached_fn,
+    const common_robotics_utilities::simple_rrt_planner
+        ::GoalReachedCallbackFunction<StateType>& goal_reached_callback,
+    const common_robotics_utilities::simple_rrt_planner
+        ::PlanningTerminationCheckFunction& termination_check_fn,
+    const size_t batch_size, const int32_t num_threads)
+{
+  using common_robotics_utilities::simple_rrt_planner::ForwardPropagation;
+  if (batch_size < 1)
+  {
+    throw std::invalid_argument("batch_size < 1");
+  }
+  if (num_threads < 1)
+  {
+    throw std::invalid_argument("num_threads < 1");
+  }
+  std::map<std::string, double> statistics;
+  statistics["total_samples"] = 0.0;
+  statistics["successful_samples"] = 0.0;
+  statistics["failed_samples"] = 0.0;
+  statistics["expansion_batches"] = 0.0;
+  std::vector<int64_t> goal_state_indices;
+  // Check if any starting states already meet the goal conditions
+  for (size_t idx = 0; idx < tree.size(); idx++)
+  {
+    if (goal_reached_fn(tree.at(idx).GetValueImmutable()))
+    {
+      goal_state_indices.push_back(static_cast<int64_t>(idx));
+      if (goal_reached_callback)
+      {
+        goal_reached_callback(tree, static_cast<int64_t>(idx));
+      }
+    }
+  }
+  const auto start_time = std::chrono::steady_clock::now();
+  std::vector<SampleType> samples;
+  samples.reserve(batch_size);
+  std::vector<int64_t> nearest_indices;
+  nearest_indices.reserve(batch_size);
+  int64_t num_samples_drawn = 0;
+  bool nearest_neighbor_found = true;
+  while (nearest_neighbor_found
+         && !termination_check_fn(static_cast<int64_t>(tree.size())))
+  {
+    // Draw samples and find their nearest neighbors serially
+    samples.clear();
+    nearest_indices.clear();
+    const int64_t first_sample_index = num_samples_drawn;
+    while (samples.size() < batch_size)
+    {
+      const SampleType random_target = sampling_fn();
+      const int64_t nearest_neighbor_index
+          = nearest_neighbor_fn(tree, random_target);
+      if (nearest_neighbor_index < 0)
+      {
+        // Nothing left in the tree to expand from (e.g. every state has been
+        // blacklisted), so finish this batch and stop.
+        nearest_neighbor_found = false;
+        break;
+      }
+      samples.push_back(random_target);
+      nearest_indices.push_back(nearest_neighbor_index);
+      num_samples_drawn++;
+    }
+    // Forward propagate the batch in parallel. The tree is not modified until
+    // every propagation is done, so references into it remain valid.
+    std::vector<ForwardPropagation<StateType>> propagations(samples.size());
+    std::vector<std::exception_ptr> propagation_errors(samples.size());
+    #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+    for (size_t idx = 0; idx < samples.size(); idx++)
+    {
+      try
+      {
+        const StateType& nearest_neighbor
+            = tree.at(static_cast<size_t>(nearest_indices.at(idx)))
+                .GetValueImmutable();
+        propagations.at(idx) = forward_propagation_fn(
+            nearest_neighbor, samples.at(idx),
+            first_sample_index + static_cast<int64_t>(idx));
+      }
+      catch (...)
+      {
+        // Exceptions cannot leave an OpenMP parallel region
+        propagation_errors.at(idx) = std::current_exception();
+      }
+    }
+    for (const std::exception_ptr& propagation_error : propagation_errors)
+    {
+      if (propagation_error)
+      {
+        std::rethrow_exception(propagation_error);
+      }
+    }
+    statistics["expansion_batches"] += 1.0;
+    // Merge the propagated states into the tree in sample order
+    for (size_t idx = 0; idx < propagations.size(); idx++)
+    {
+      statistics["total_samples"] += 1.0;
+      ForwardPropagation<StateType>& propagated = propagations.at(idx);
+      if (propagated.empty())
+      {
+        statistics["failed_samples"] += 1.0;
+        continue;
+      }
+      statistics["successful_samples"] += 1.0;
+      const int64_t nearest_neighbor_index = nearest_indices.at(idx);
+      const int64_t first_new_index = static_cast<int64_t>(tree.size());
+      for (size_t pdx = 0; pdx < propagated.size(); pdx++)
+      {
+        // A negative relative parent index means the nearest neighbor,
+        // otherwise it is the index of an earlier state in the propagation.
+        const int64_t relative_parent_index
+            = propagated.at(pdx).RelativeParentIndex();
+        int64_t parent_index = nearest_neighbor_index;
+        if (relative_parent_index >= 0)
+        {
+          if (relative_parent_index >= static_cast<int64_t>(pdx))
+          {
+            throw std::runtime_error(
+                "relative_parent_index >= index of propagated state");
+          }
+          parent_index = first_new_index + relative_parent_index;
+        }
+        // SimpleRRTPlannerState can only copy its value, so add an empty
+        // state and move the propagated state into it instead.
+        tree.emplace_back(StateType(), parent_index);
+        tree.back().GetValueMutable()
+            = std::move(propagated.at(pdx).MutableState());
+        const int64_t new_state_index = static_cast<int64_t>(tree.size() - 1);
+        tree.at(static_cast<size_t>(parent_index))
+            .AddChildIndex(new_state_index);
+        if (state_added_callback)
+        {
+          state_added_callback(tree, new_state_index);
+        }
+        if (goal_reached_fn(
+                tree.at(static_cast<size_t>(new_state_index))
+                    .GetValueImmutable()))
+        {
+          goal_state_indices.push_back(new_state_index);
+          if (goal_reached_callback)
+          {
+            goal_reached_callback(tree, new_state_index);
+          }
+        }
+      }
+    }
+  }
+  // Extract the solution paths
+  std::vector<Container> planned_paths;
+  planned_paths.reserve(goal_state_indices.size());
+  for (const int64_t goal_state_index : goal_state_indices)
+  {
+    planned_paths.push_back(
+        common_robotics_utilities::simple_rrt_planner::ExtractSolutionPath<
+            StateType, Container>(tree, goal_state_index));
+  }
+  const std::chrono::duration<double> planning_time
+      = std::chrono::steady_clock::now() - start_time;
+  statistics["planning_time"] = planning_time.count();
+  statistics["total_states"] = static_cast<double>(tree.size());
+  statistics["solutions"] = static_cast<double>(planned_paths.size());
+  return common_robotics_utilities::simple_rrt_planner
+      ::MultipleSolutionPlanningResults<StateType, Container>(
+          planned_paths, statistics);
+}
+}  // namespace uncertainty_planning_core
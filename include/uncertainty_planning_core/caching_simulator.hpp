@@ -0,0 +1,524 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include <common_robotics_utilities/serialization.hpp>
+#include <uncertainty_planning_core/execution_policy.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
+#include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+#include <uncertainty_planning_core/simulator_decorator.hpp>
+
+namespace uncertainty_planning_core
+{
+template<typename Configuration, typename ConfigSerializer>
+inline uint64_t SerializeSimulationResult(
+    const SimulationResult<Configuration>& result, std::vector<uint8_t>& buffer)
+{
+  using common_robotics_utilities::serialization::SerializeMemcpyable;
+  const uint64_t start_buffer_size = buffer.size();
+  ConfigSerializer::Serialize(result.ResultConfig(), buffer);
+  ConfigSerializer::Serialize(result.ActualTarget(), buffer);
+  SerializeMemcpyable<uint8_t>(
+      static_cast<uint8_t>(result.DidContact()), buffer);
+  SerializeMemcpyable<uint8_t>(
+      static_cast<uint8_t>(result.OutcomeIsNominallyIndependent()), buffer);
+  return buffer.size() - start_buffer_size;
+}
+
+template<typename Configuration, typename ConfigSerializer>
+inline common_robotics_utilities::serialization::Deserialized<
+    SimulationResult<Configuration>>
+DeserializeSimulationResult(
+    const std::vector<uint8_t>& buffer, const uint64_t starting_offset)
+{
+  using common_robotics_utilities::serialization::DeserializeMemcpyable;
+  using common_robotics_utilities::serialization::MakeDeserialized;
+  uint64_t current_position = starting_offset;
+  const auto result_config_deserialized
+      = ConfigSerializer::Deserialize(buffer, current_position);
+  current_position += result_config_deserialized.BytesRead();
+  const auto actual_target_deserialized
+      = ConfigSerializer::Deserialize(buffer, current_position);
+  current_position += actual_target_deserialized.BytesRead();
+  const auto did_contact_deserialized
+      = DeserializeMemcpyable<uint8_t>(buffer, current_position);
+  current_position += did_contact_deserialized.BytesRead();
+  const auto nominally_independent_deserialized
+      = DeserializeMemcpyable<uint8_t>(buffer, current_position);
+  current_position += nominally_independent_deserialized.BytesRead();
+  const SimulationResult<Configuration> result(
+      result_config_deserialized.Value(), actual_target_deserialized.Value(),
+      did_contact_deserialized.Value() > 0u,
+      nominally_independent_deserialized.Value() > 0u);
+  return MakeDeserialized(result, current_position - starting_offset);
+}
+
+/// 64-bit FNV-1a hash of bytes.
+inline uint64_t HashBytes(const std::vector<uint8_t>& bytes)
+{
+  uint64_t hash = 0xcbf29ce484222325u;
+  for (const uint8_t byte : bytes)
+  {
+    hash ^= byte;
+    hash *= 0x100000001b3u;
+  }
+  return hash;
+}
+
+/// Serialize the inputs of a batch simulation (other than the simulator
+/// itself), e.g. to hash them. Views of the same particles serialize the
+/// same, whether or not they are broadcasts.
+template<typename Configuration, typename ConfigSerializer>
+inline void SerializeSimulationInputs(
+    const bool reverse, const ParticleView<Configuration>& start_positions,
+    const ParticleView<Configuration>& target_positions,
+    const bool allow_contacts, const uint64_t random_stream_key,
+    std::vector<uint8_t>& buffer)
+{
+  using common_robotics_utilities::serialization::SerializeMemcpyable;
+  SerializeMemcpyable<uint8_t>(static_cast<uint8_t>(reverse), buffer);
+  SerializeMemcpyable<uint8_t>(static_cast<uint8_t>(allow_contacts), buffer);
+  SerializeMemcpyable<uint64_t>(random_stream_key, buffer);
+  const auto serialize_particles
+      = [&] (const ParticleView<Configuration>& particles)
+  {
+    SerializeMemcpyable<uint64_t>(
+        static_cast<uint64_t>(particles.Size()), buffer);
+    for (size_t idx = 0; idx < particles.Size(); idx++)
+    {
+      ConfigSerializer::Serialize(particles[idx], buffer);
+    }
+  };
+  serialize_particles(start_positions);
+  serialize_particles(target_positions);
+}
+
+enum class SimulationResultCacheLookup : uint8_t
+{
+  MISS = 0,
+  MEMORY_HIT = 1,
+  DIRECTORY_HIT = 2
+};
+
+/// Batches of simulation results, stored by a 64-bit key that hashes
+/// everything the results depend on (see CachingSimulator). Up to
+/// max_cached_batches of the most recently used batches are kept in memory.
+/// If cache_directory is not empty, every batch is also stored there in its
+/// own file, named by its key, so that results persist across runs (and
+/// processes). The directory must already exist. Failures to store a batch
+/// in the directory are logged, and otherwise ignored, like failures to load
+/// one. A cache can be shared by simulators used from multiple threads.
+template<typename Configuration, typename ConfigSerializer>
+class SimulationResultCache
+{
+public:
+  using SimulationResults = std::vector<SimulationResult<Configuration>>;
+
+private:
+  using CacheEntry = std::pair<uint64_t, SimulationResults>;
+  using CacheEntryList = std::list<CacheEntry>;
+
+  const size_t max_cached_batches_;
+  const std::string cache_directory_;
+  std::mutex mutex_;
+  // Most recently used first
+  CacheEntryList entries_;
+  std::unordered_map<uint64_t, typename CacheEntryList::iterator>
+      entry_index_;
+  LoggingFunction logging_fn_;
+
+  std::string MakeFilePath(const uint64_t key) const
+  {
+    char key_string[17];
+    snprintf(key_string, sizeof(key_string), "%016llx",
+             static_cast<unsigned long long>(key));
+    return cache_directory_ + "/" + std::string(key_string) + ".simcache";
+  }
+
+  bool LoadFromDirectory(const uint64_t key, SimulationResults& results) const
+  {
+    using common_robotics_utilities::serialization::DeserializeMemcpyable;
+    std::ifstream input_file(
+        MakeFilePath(key), std::ios::in|std::ios::binary);
+    if (input_file.good() == false)
+    {
+      return false;
+    }
+    input_file.seekg(0, std::ios::end);
+    std::streampos end = input_file.tellg();
+    input_file.seekg(0, std::ios::beg);
+    std::streampos begin = input_file.tellg();
+    const std::streamsize serialized_size = end - begin;
+    std::vector<uint8_t> buffer(static_cast<size_t>(serialized_size), 0x00);
+    input_file.read(reinterpret_cast<char*>(buffer.data()), serialized_size);
+    // A truncated or otherwise unreadable file (e.g. from a run that was
+    // killed while writing it) is treated as a miss, and will be overwritten.
+    try
+    {
+      uint64_t current_position = 0;
+      const auto key_deserialized
+          = DeserializeMemcpyable<uint64_t>(buffer, current_position);
+      current_position += key_deserialized.BytesRead();
+      if (key_deserialized.Value() != key)
+      {
+        return false;
+      }
+      const auto size_deserialized
+          = DeserializeMemcpyable<uint64_t>(buffer, current_position);
+      current_position += size_deserialized.BytesRead();
+      SimulationResults loaded_results;
+      loaded_results.reserve(static_cast<size_t>(size_deserialized.Value()));
+      for (uint64_t idx = 0; idx < size_deserialized.Value(); idx++)
+      {
+        const auto result_deserialized
+            = DeserializeSimulationResult<Configuration, ConfigSerializer>(
+                buffer, current_position);
+        loaded_results.push_back(result_deserialized.Value());
+        current_position += result_deserialized.BytesRead();
+      }
+      results = loaded_results;
+      return true;
+    }
+    catch (const std::exception&)
+    {
+      return false;
+    }
+  }
+
+  void StoreInDirectory(
+      const uint64_t key, const SimulationResults& results)
+  {
+    using common_robotics_utilities::serialization::SerializeMemcpyable;
+    std::vector<uint8_t> buffer;
+    SerializeMemcpyable<uint64_t>(key, buffer);
+    SerializeMemcpyable<uint64_t>(
+        static_cast<uint64_t>(results.size()), buffer);
+    for (const SimulationResult<Configuration>& result : results)
+    {
+      SerializeSimulationResult<Configuration, ConfigSerializer>(
+          result, buffer);
+    }
+    // Write to a temporary file first, so that other threads and processes
+    // never see a partially-written file. Thread IDs can repeat across
+    // processes, so the temporary file name also has a random part.
+    const std::string file_path = MakeFilePath(key);
+    std::random_device random_device;
+    const std::string temporary_file_path
+        = file_path + ".tmp"
+          + std::to_string(std::hash<std::thread::id>()(
+              std::this_thread::get_id()))
+          + "_" + std::to_string(random_device());
+    std::ofstream output_file(
+        temporary_file_path, std::ios::out|std::ios::binary);
+    output_file.write(reinterpret_cast<const char*>(buffer.data()),
+                      static_cast<std::streamsize>(buffer.size()));
+    output_file.close();
+    if (output_file.fail()
+        || rename(temporary_file_path.c_str(), file_path.c_str()) != 0)
+    {
+      remove(temporary_file_path.c_str());
+      std::lock_guard<std::mutex> lock(mutex_);
+      logging_fn_(
+          "Failed to store simulation results in " + file_path, 1);
+    }
+  }
+
+  void InsertInMemory(const uint64_t key, const SimulationResults& results)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found_itr = entry_index_.find(key);
+    if (found_itr != entry_index_.end())
+    {
+      entries_.erase(found_itr->second);
+      entry_index_.erase(found_itr);
+    }
+    entries_.emplace_front(key, results);
+    entry_index_[key] = entries_.begin();
+    while (entries_.size() > max_cached_batches_)
+    {
+      entry_index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+
+public:
+  SimulationResultCache(
+      const size_t max_cached_batches, const std::string& cache_directory)
+      : max_cached_batches_(max_cached_batches),
+        cache_directory_(cache_directory),
+        logging_fn_([] (const std::string& msg, const int32_t level)
+            { std::cout << "Log [" << level << "] : " << msg << std::endl; })
+  {}
+
+  SimulationResultCache(const SimulationResultCache&) = delete;
+
+  SimulationResultCache& operator=(const SimulationResultCache&) = delete;
+
+  /// Must not be called while the cache is in use.
+  void RegisterLoggingFunction(const LoggingFunction& logging_fn)
+  {
+    logging_fn_ = logging_fn;
+  }
+
+  /// Copy the results stored by key into results, from memory if they are
+  /// there, otherwise from the cache directory.
+  SimulationResultCacheLookup Lookup(
+      const uint64_t key, SimulationResults& results)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      const auto found_itr = entry_index_.find(key);
+      if (found_itr != entry_index_.end())
+      {
+        // Move the entry to the front
+        entries_.splice(entries_.begin(), entries_, found_itr->second);
+        results = found_itr->second->second;
+        return SimulationResultCacheLookup::MEMORY_HIT;
+      }
+    }
+    if (cache_directory_.size() > 0 && LoadFromDirectory(key, results))
+    {
+      InsertInMemory(key, results);
+      return SimulationResultCacheLookup::DIRECTORY_HIT;
+    }
+    return SimulationResultCacheLookup::MISS;
+  }
+
+  void Store(const uint64_t key, const SimulationResults& results)
+  {
+    InsertInMemory(key, results);
+    if (cache_directory_.size() > 0)
+    {
+      StoreInDirectory(key, results);
+    }
+  }
+
+  /// Number of batches held in memory.
+  size_t Size()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return entries_.size();
+  }
+
+  /// Clear the batches held in memory; the cache directory is left as-is.
+  void Clear()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_.clear();
+    entry_index_.clear();
+  }
+};
+
+/// Simulator decorator that serves repeated ForwardSimulateRobots() and
+/// ReverseSimulateRobots() calls (and their particle-view variants) from a
+/// SimulationResultCache, e.g. so that benchmark reruns with a fixed seed do
+/// not pay for physics again. Single-robot simulations are not cached.
+///
+/// Results are keyed by a hash of the simulation inputs (see
+/// SerializeSimulationInputs()), the state of the random generator, and
+/// simulator_key, which must identify everything else the wrapped
+/// simulator's results depend on (e.g. its step size, robot, and
+/// environment), so that stored results of differently-configured simulators
+/// are kept apart. A cache hit leaves the random generator as it was, so runs
+/// are only reproduced exactly if the random stream is set before every
+/// simulation, as the planner does.
+template<typename Configuration, typename ConfigSerializer, typename RNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class CachingSimulator
+    : public SimulatorDecorator<Configuration, RNG, ConfigAlloc>
+{
+public:
+  using Decorator = SimulatorDecorator<Configuration, RNG, ConfigAlloc>;
+  using Simulator = typename Decorator::Simulator;
+  using SimulatorPtr = typename Decorator::SimulatorPtr;
+  using SimulationResults = typename Decorator::SimulationResults;
+  using Cache = SimulationResultCache<Configuration, ConfigSerializer>;
+  using CachePtr = std::shared_ptr<Cache>;
+
+protected:
+  using Robot = typename Decorator::Robot;
+
+private:
+  CachePtr cache_ptr_;
+  std::string simulator_key_;
+  uint64_t memory_hits_;
+  uint64_t directory_hits_;
+  uint64_t misses_;
+
+  uint64_t MakeCacheKey(
+      const bool reverse, const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts)
+  {
+    using common_robotics_utilities::serialization::SerializeMemcpyable;
+    std::vector<uint8_t> key_buffer(
+        simulator_key_.begin(), simulator_key_.end());
+    // Fingerprint the random generator's state by drawing from a copy
+    RNG random_generator = this->GetRandomGenerator();
+    SerializeMemcpyable<uint64_t>(
+        static_cast<uint64_t>(random_generator()), key_buffer);
+    SerializeSimulationInputs<Configuration, ConfigSerializer>(
+        reverse, start_positions, target_positions, allow_contacts,
+        this->GetRandomStreamKey(), key_buffer);
+    return HashBytes(key_buffer);
+  }
+
+  SimulationResults CachedSimulate(
+      const bool reverse, const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<SimulationResults(void)>& simulate_fn)
+  {
+    const uint64_t key = MakeCacheKey(
+        reverse, start_positions, target_positions, allow_contacts);
+    SimulationResults results;
+    const SimulationResultCacheLookup lookup = cache_ptr_->Lookup(key, results);
+    if (lookup == SimulationResultCacheLookup::MEMORY_HIT)
+    {
+      memory_hits_++;
+    }
+    else if (lookup == SimulationResultCacheLookup::DIRECTORY_HIT)
+    {
+      directory_hits_++;
+    }
+    else
+    {
+      misses_++;
+      results = simulate_fn();
+      cache_ptr_->Store(key, results);
+    }
+    return results;
+  }
+
+public:
+  CachingSimulator(
+      const SimulatorPtr& simulator_ptr, const CachePtr& cache_ptr,
+      const std::string& simulator_key)
+      : Decorator(simulator_ptr), cache_ptr_(cache_ptr),
+        simulator_key_(simulator_key), memory_hits_(0u), directory_hits_(0u),
+        misses_(0u)
+  {
+    if (!cache_ptr_)
+    {
+      throw std::invalid_argument("cache_ptr is null");
+    }
+  }
+
+  const CachePtr& GetCache() const { return cache_ptr_; }
+
+  /// Clones share the cache.
+  SimulatorPtr CloneSimulator(const uint64_t prng_seed) const override
+  {
+    const SimulatorPtr simulator_clone
+        = this->GetWrappedSimulator()->CloneSimulator(prng_seed);
+    if (!simulator_clone)
+    {
+      return SimulatorPtr();
+    }
+    return std::make_shared<CachingSimulator>(
+        simulator_clone, cache_ptr_, simulator_key_);
+  }
+
+  std::map<std::string, double> GetStatistics() const override
+  {
+    std::map<std::string, double> statistics = Decorator::GetStatistics();
+    statistics["cached_simulation_memory_hits"]
+        = static_cast<double>(memory_hits_);
+    statistics["cached_simulation_directory_hits"]
+        = static_cast<double>(directory_hits_);
+    statistics["cached_simulation_misses"] = static_cast<double>(misses_);
+    return statistics;
+  }
+
+  void ResetStatistics() override
+  {
+    Decorator::ResetStatistics();
+    memory_hits_ = 0u;
+    directory_hits_ = 0u;
+    misses_ = 0u;
+  }
+
+  SimulationResults ForwardSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return CachedSimulate(
+        false, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts,
+        [&] (void)
+    {
+      return Decorator::ForwardSimulateRobots(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return CachedSimulate(
+        false, start_positions, target_positions, allow_contacts, [&] (void)
+    {
+      return Decorator::ForwardSimulateParticles(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ReverseSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return CachedSimulate(
+        true, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts,
+        [&] (void)
+    {
+      return Decorator::ReverseSimulateRobots(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return CachedSimulate(
+        true, start_positions, target_positions, allow_contacts, [&] (void)
+    {
+      return Decorator::ReverseSimulateParticles(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+};
+}  // namespace uncertainty_planning_core
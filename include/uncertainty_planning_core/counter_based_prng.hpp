@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <limits>
+
+namespace uncertainty_planning_core
+{
+/// Counter-based random number generator using the Philox4x32-10 bijection
+/// (Salmon et al., "Parallel Random Numbers: As Easy as 1, 2, 3", SC 2011).
+/// Each (seed, stream) pair is an independent stream of random numbers, and
+/// creating a stream is just storing the pair, so streams can be keyed by
+/// whatever identifies the work being done (e.g. a transition ID or particle
+/// index) and give the same numbers regardless of which thread does the work.
+///
+/// Satisfies UniformRandomBitGenerator, so it can be used with the standard
+/// library random distributions.
+class Philox4x32PRNG
+{
+public:
+  using result_type = uint64_t;
+
+private:
+  uint32_t key_[2];
+  uint64_t stream_;
+  uint64_t block_counter_;
+  uint64_t block_[2];
+  size_t block_position_;
+
+  static inline void MultiplyHighLow(
+      const uint32_t a, const uint32_t b, uint32_t& high, uint32_t& low)
+  {
+    const uint64_t product
+        = static_cast<uint64_t>(a) * static_cast<uint64_t>(b);
+    high = static_cast<uint32_t>(product >> 32);
+    low = static_cast<uint32_t>(product);
+  }
+
+  void GenerateBlock()
+  {
+    const uint32_t multiplier_0 = 0xD2511F53u;
+    const uint32_t multiplier_1 = 0xCD9E8D57u;
+    const uint32_t weyl_0 = 0x9E3779B9u;
+    const uint32_t weyl_1 = 0xBB67AE85u;
+    uint32_t counter[4] = {static_cast<uint32_t>(block_counter_),
+                           static_cast<uint32_t>(block_counter_ >> 32),
+                           static_cast<uint32_t>(stream_),
+                           static_cast<uint32_t>(stream_ >> 32)};
+    uint32_t key[2] = {key_[0], key_[1]};
+    for (int32_t round = 0; round < 10; round++)
+    {
+      uint32_t high_0 = 0u;
+      uint32_t low_0 = 0u;
+      uint32_t high_1 = 0u;
+      uint32_t low_1 = 0u;
+      MultiplyHighLow(multiplier_0, counter[0], high_0, low_0);
+      MultiplyHighLow(multiplier_1, counter[2], high_1, low_1);
+      counter[0] = high_1 ^ counter[1] ^ key[0];
+      counter[1] = low_1;
+      counter[2] = high_0 ^ counter[3] ^ key[1];
+      counter[3] = low_0;
+      key[0] += weyl_0;
+      key[1] += weyl_1;
+    }
+    block_[0] = (static_cast<uint64_t>(counter[1]) << 32) | counter[0];
+    block_[1] = (static_cast<uint64_t>(counter[3]) << 32) | counter[2];
+    block_counter_++;
+    block_position_ = 0;
+  }
+
+public:
+  Philox4x32PRNG(const uint64_t seed, const uint64_t stream)
+      : stream_(stream), block_counter_(0), block_position_(2)
+  {
+    key_[0] = static_cast<uint32_t>(seed);
+    key_[1] = static_cast<uint32_t>(seed >> 32);
+    block_[0] = 0u;
+    block_[1] = 0u;
+  }
+
+  static constexpr result_type min()
+  {
+    return std::numeric_limits<result_type>::min();
+  }
+
+  static constexpr result_type max()
+  {
+    return std::numeric_limits<result_type>::max();
+  }
+
+  result_type operator()()
+  {
+    if (block_position_ >= 2)
+    {
+      GenerateBlock();
+    }
+    const result_type value = block_[block_position_];
+    block_position_++;
+    return value;
+  }
+};
+
+/// Derive a 64-bit key (e.g. to seed another generator, or as the seed of
+/// per-particle Philox4x32PRNG streams) for the given seed and stream.
+inline uint64_t MakeRandomStreamKey(const uint64_t seed, const uint64_t stream)
+{
+  Philox4x32PRNG prng(seed, stream);
+  return prng();
+}
+}  // namespace uncertainty_planning_core
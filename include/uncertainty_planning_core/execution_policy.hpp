@@ -8,7 +8,9 @@
 #include <iostream>
 #include <stdexcept>
 #include <functional>
+#include <numeric>
 #include <queue>
+#include <utility>
 #include <common_robotics_utilities/openmp_helpers.hpp>
 #include <common_robotics_utilities/print.hpp>
 #include <common_robotics_utilities/serialization.hpp>
@@ -16,7 +18,9 @@
 #include <common_robotics_utilities/simple_graph.hpp>
 #include <common_robotics_utilities/simple_graph_search.hpp>
 #include <common_robotics_utilities/simple_knearest_neighbors.hpp>
+#include <uncertainty_planning_core/planning_tree_traversal.hpp>
 #include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/transition_children_index.hpp>
 #include <uncertainty_planning_core/uncertainty_planner_state.hpp>
 
 namespace uncertainty_planning_core
@@ -401,6 +405,9 @@ private:
   bool initialized_ = false;
   // Raw data used to rebuild the policy graph
   UncertaintyPlanningTree planner_tree_;
+  // Children of each planner tree state grouped by transition, updated as
+  // states are added to the planner tree
+  TransitionChildrenIndex transition_children_index_;
   Configuration goal_;
   double marginal_edge_weight_ = 0.0;
   double conformant_planning_threshold_ = 0.0;
@@ -466,6 +473,25 @@ public:
     RebuildPolicyGraph();
   }
 
+  /// Takes ownership of planner_tree, rather than copying it.
+  ExecutionPolicy(
+      UncertaintyPlanningTree&& planner_tree, const Configuration& goal,
+      const double marginal_edge_weight,
+      const double conformant_planning_threshold,
+      const uint32_t edge_attempt_threshold,
+      const uint32_t policy_action_attempt_count,
+      const LoggingFunction& logging_fn)
+      : initialized_(true), planner_tree_(std::move(planner_tree)),
+        goal_(goal),
+        marginal_edge_weight_(marginal_edge_weight),
+        conformant_planning_threshold_(conformant_planning_threshold),
+        edge_attempt_threshold_(edge_attempt_threshold),
+        policy_action_attempt_count_(policy_action_attempt_count),
+        logging_fn_(logging_fn)
+  {
+    RebuildPolicyGraph();
+  }
+
   ExecutionPolicy()
     : initialized_(false),
       logging_fn_([] (const std::string& msg, const int32_t level)
@@ -616,6 +642,7 @@ public:
             UncertaintyPlanningTreeState, UncertaintyPlanningTree>(
                 buffer, current_position, planning_tree_state_deserializer_fn);
     planner_tree_ = planner_tree_deserialized.Value();
+    transition_children_index_.Clear();
     current_position += planner_tree_deserialized.BytesRead();
     // Deserialize the goal
     const auto goal_deserialized
@@ -1617,6 +1644,8 @@ private:
 
   void UpdatePlannerTreeProbabilities()
   {
+    // Index any states added since the last update
+    transition_children_index_.Update(planner_tree_);
     // Let's update the entire tree. This is slower than it could be, but I
     // don't want to miss anything
     UpdateChildTransitionProbabilities(0);
@@ -1660,49 +1689,37 @@ private:
     }
   }
 
-  void UpdateChildTransitionProbabilities(const int64_t current_state_index)
+  void UpdateChildTransitionProbabilities(const int64_t root_state_index)
   {
-    // Gather all the children, split them by transition, and recompute the
-    // P(->)estimated edge probabilities
-    const UncertaintyPlanningTreeState& current_tree_state
-        = planner_tree_.at(static_cast<size_t>(current_state_index));
-    const std::vector<int64_t>& child_state_indices
-        = current_tree_state.GetChildIndices();
-    // Split them by transition IDs
-    std::map<uint64_t, std::vector<int64_t>> transition_children_map;
-    for (const int64_t child_state_index : child_state_indices)
-    {
-      const UncertaintyPlanningTreeState& child_tree_state
-          = planner_tree_.at(static_cast<size_t>(child_state_index));
-      const UncertaintyPlanningState& child_state
-          = child_tree_state.GetValueImmutable();
-      const uint64_t child_state_transition_id
-          = child_state.GetTransitionId();
-      transition_children_map[child_state_transition_id]
-          .push_back(child_state_index);
-    }
-    // Compute updated probabilites for each group
-    for (auto itr = transition_children_map.begin();
-         itr != transition_children_map.end(); ++itr)
-    {
-      const std::vector<int64_t> transition_child_indices = itr->second;
-      // I don't know why this needs the return type declared, but it does.
-      const std::function<UncertaintyPlanningState&(const int64_t)>
-          get_planning_state_fn
-              = [&] (const int64_t state_index) -> UncertaintyPlanningState&
-      {
-        return planner_tree_.at(static_cast<size_t>(state_index))
-            .GetValueMutable();
-      };
-      UpdateEstimatedEffectiveProbabilities(
-          get_planning_state_fn, transition_child_indices,
-          edge_attempt_threshold_, logging_fn_);
-    }
-    // Perform the same update on all of our children
-    for (const int64_t child_state_index : child_state_indices)
+    // I don't know why this needs the return type declared, but it does.
+    const std::function<UncertaintyPlanningState&(const int64_t)>
+        get_planning_state_fn
+            = [&] (const int64_t state_index) -> UncertaintyPlanningState&
     {
-      UpdateChildTransitionProbabilities(child_state_index);
-    }
+      return planner_tree_.at(static_cast<size_t>(state_index))
+          .GetValueMutable();
+    };
+    // For every state in the subtree, gather all the children, split by
+    // transition, and recompute the P(->)estimated edge probabilities
+    const PlanningTreeChildren tree_children(planner_tree_);
+    TraverseDepthFirst(
+        root_state_index,
+        [&] (const int64_t state_index)
+        {
+          return tree_children.GetChildIndices(state_index);
+        },
+        [&] (const int64_t state_index)
+        {
+          // Compute updated probabilites for each transition
+          for (const TransitionChildren& transition
+                  : transition_children_index_.GetTransitions(state_index))
+          {
+            UpdateEstimatedEffectiveProbabilities(
+                get_planning_state_fn, transition.ChildIndices(),
+                edge_attempt_threshold_, logging_fn_);
+          }
+          return true;
+        });
   }
 
   void UpdateStateGoalReachedProbability(const int64_t current_state_index)
@@ -1724,27 +1741,16 @@ private:
     // (split goal probability * probability of split)
     //
     // We can identify split nodes as children which share a transition id
-    // First, we go through the children and separate them based on transition
-    // id (this puts all the children of a split together in one place)
-    std::map<uint64_t, std::vector<int64_t>> effective_child_branches;
-    for (const int64_t current_child_index
-            : current_tree_state.GetChildIndices())
-    {
-      const uint64_t& child_transition_id
-          = planner_tree_.at(static_cast<size_t>(current_child_index))
-              .GetValueImmutable().GetTransitionId();
-      effective_child_branches[child_transition_id]
-          .push_back(current_child_index);
-    }
-    // Now that we have the transitions separated out, compute the goal
-    // probability of each transition
+    // The transition children index keeps the children grouped by transition
+    // id (this puts all the children of a split together in one place), so
+    // compute the goal probability of each transition
     std::vector<double> effective_child_branch_probabilities;
-    for (auto itr = effective_child_branches.begin();
-         itr != effective_child_branches.end(); ++itr)
+    for (const TransitionChildren& transition
+            : transition_children_index_.GetTransitions(current_state_index))
     {
       const double transtion_goal_probability
           = ComputeTransitionGoalProbability(
-              itr->second, edge_attempt_threshold_);
+              transition.ChildIndices(), edge_attempt_threshold_);
       effective_child_branch_probabilities.push_back(
           transtion_goal_probability);
     }
@@ -1781,19 +1787,17 @@ private:
       const std::vector<int64_t>& child_node_indices,
       const uint32_t edge_attempt_threshold) const
   {
-    UncertaintyPlanningStateVector child_states(
-        child_node_indices.size());
-    for (size_t idx = 0; idx < child_node_indices.size(); idx++)
+    // I don't know why this needs the return type declared, but it does.
+    const std::function<const UncertaintyPlanningState&(const int64_t)>
+        get_planning_state_fn
+            = [&] (const int64_t state_index) -> const UncertaintyPlanningState&
     {
-      // Get the current child
-      const int64_t& current_child_index = child_node_indices.at(idx);
-      const UncertaintyPlanningState& current_child
-          = planner_tree_.at(static_cast<size_t>(current_child_index))
-              .GetValueImmutable();
-      child_states.at(idx) = current_child;
-    }
+      return planner_tree_.at(static_cast<size_t>(state_index))
+          .GetValueImmutable();
+    };
     return ComputeTransitionGoalProbability(
-        child_states, edge_attempt_threshold, logging_fn_);
+        get_planning_state_fn, child_node_indices, edge_attempt_threshold,
+        logging_fn_);
   }
 
 public:
@@ -1864,17 +1868,42 @@ public:
       const UncertaintyPlanningStateVector& child_nodes,
       const uint32_t planner_action_try_attempts,
       const LoggingFunction& logging_fn)
+  {
+    // I don't know why this needs the return type declared, but it does.
+    const std::function<const UncertaintyPlanningState&(const int64_t)>
+        get_planning_state_fn
+            = [&] (const int64_t state_index) -> const UncertaintyPlanningState&
+    {
+      return child_nodes.at(static_cast<size_t>(state_index));
+    };
+    std::vector<int64_t> child_node_indices(child_nodes.size(), 0);
+    std::iota(child_node_indices.begin(), child_node_indices.end(), 0);
+    return ComputeTransitionGoalProbability(
+        get_planning_state_fn, child_node_indices, planner_action_try_attempts,
+        logging_fn);
+  }
+
+  /// Compute the goal probability of the transition with the given child
+  /// states, which are accessed through get_planning_state_fn, so that they
+  /// can be read in place (e.g. from a planner tree) without being copied.
+  static double ComputeTransitionGoalProbability(
+      const std::function<const UncertaintyPlanningState&(const int64_t)>&
+          get_planning_state_fn,
+      const std::vector<int64_t>& child_node_indices,
+      const uint32_t planner_action_try_attempts,
+      const LoggingFunction& logging_fn)
   {
     // Let's handle the special cases first
     // The most common case - a non-split transition
-    if (child_nodes.size() == 1)
+    if (child_node_indices.size() == 1)
     {
-      const UncertaintyPlanningState& current_child = child_nodes.front();
+      const UncertaintyPlanningState& current_child
+          = get_planning_state_fn(child_node_indices.front());
       return (current_child.GetGoalPfeasibility()
               * current_child.GetEffectiveEdgePfeasibility());
     }
     // IMPOSSIBLE (but we handle it just to be sure)
-    else if (child_nodes.size() == 0)
+    else if (child_node_indices.size() == 0)
     {
       return 0.0;
     }
@@ -1887,8 +1916,10 @@ public:
            try_attempt < planner_action_try_attempts; try_attempt++)
       {
         const double attempt_percent_active = percent_active;
-        for (const UncertaintyPlanningState& current_child : child_nodes)
+        for (const int64_t child_node_index : child_node_indices)
         {
+          const UncertaintyPlanningState& current_child
+              = get_planning_state_fn(child_node_index);
           const double percent_reached_child =
               attempt_percent_active * current_child.GetRawEdgePfeasibility();
           const double raw_child_goal_Pfeasibility =
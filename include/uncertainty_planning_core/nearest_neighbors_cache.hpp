@@ -0,0 +1,157 @@
+#pragma once
+
+#include <stdint.h>
+#include <limits>
+#include <memory>
+#include <vector>
+#include <Eigen/Geometry>
+#include <uncertainty_planning_core/weighted_euclidean_distance.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Structure-of-arrays cache of the per-state data used by planner
+/// nearest-neighbor queries. For each state in the planning tree (by index),
+/// it stores the expectation and the combined feasibility/variance weight, so
+/// queries only need to compute a scaled distance over contiguous arrays rather
+/// than touch every planner state. Blacklisted states have an infinite weight.
+///
+/// If enabled with a weighted Euclidean metric (only for Eigen::VectorXd
+/// configurations), expectations are also stored in a dense matrix so that
+/// distances can be computed in batches.
+template<typename Configuration,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class NearestNeighborsCache
+{
+private:
+  std::vector<Configuration, ConfigAlloc> expectations_;
+  std::vector<double> weights_;
+  WeightedEuclideanDistanceMatrix dense_expectations_;
+
+public:
+  NearestNeighborsCache() {}
+
+  void Clear()
+  {
+    expectations_.clear();
+    weights_.clear();
+    dense_expectations_.Clear();
+  }
+
+  /// Store expectations densely and compute distances with the provided
+  /// weighted Euclidean metric. Returns false, and leaves dense distances
+  /// disabled, if Configuration is not Eigen::VectorXd.
+  bool EnableWeightedEuclideanDistance(const Eigen::VectorXd& weights)
+  {
+    if (!SupportsWeightedEuclideanDistance<Configuration>::value)
+    {
+      return false;
+    }
+    dense_expectations_ = WeightedEuclideanDistanceMatrix(weights);
+    for (const Configuration& expectation : expectations_)
+    {
+      AddDenseConfiguration(expectation, dense_expectations_);
+    }
+    return true;
+  }
+
+  void DisableWeightedEuclideanDistance()
+  {
+    dense_expectations_ = WeightedEuclideanDistanceMatrix();
+  }
+
+  bool HasDenseDistances() const { return dense_expectations_.IsValid(); }
+
+  size_t Size() const { return weights_.size(); }
+
+  void Reserve(const size_t size)
+  {
+    expectations_.reserve(size);
+    weights_.reserve(size);
+  }
+
+  void AddState(const Configuration& expectation, const double weight)
+  {
+    expectations_.push_back(expectation);
+    weights_.push_back(weight);
+    if (HasDenseDistances())
+    {
+      AddDenseConfiguration(expectation, dense_expectations_);
+    }
+  }
+
+  void AddDisabledState(const Configuration& expectation)
+  {
+    AddState(expectation, std::numeric_limits<double>::infinity());
+  }
+
+  void DisableState(const int64_t index)
+  {
+    weights_.at(static_cast<size_t>(index))
+        = std::numeric_limits<double>::infinity();
+  }
+
+  bool IsEnabled(const int64_t index) const
+  {
+    return (weights_.at(static_cast<size_t>(index))
+            < std::numeric_limits<double>::infinity());
+  }
+
+  const Configuration& GetExpectation(const int64_t index) const
+  {
+    return expectations_.at(static_cast<size_t>(index));
+  }
+
+  double GetWeight(const int64_t index) const
+  {
+    return weights_.at(static_cast<size_t>(index));
+  }
+
+  /// Weighted distance of the state at index, given the (space independent)
+  /// distance between its expectation and the query.
+  double ScaledDistance(const int64_t index, const double distance) const
+  {
+    const double weight = weights_[static_cast<size_t>(index)];
+    if (weight < std::numeric_limits<double>::infinity())
+    {
+      return weight * distance;
+    }
+    else
+    {
+      return std::numeric_limits<double>::infinity();
+    }
+  }
+
+  /// Distance between the expectation of the state at index and query, using
+  /// the dense weighted Euclidean metric.
+  double ComputeDenseDistance(
+      const int64_t index, const Configuration& query) const
+  {
+    return uncertainty_planning_core::ComputeDenseDistance(
+        dense_expectations_, index, query);
+  }
+
+  /// Distance between the expectations of two states, using the dense weighted
+  /// Euclidean metric.
+  double ComputeDenseDistance(
+      const int64_t first_index, const int64_t second_index) const
+  {
+    return dense_expectations_.ComputeDistance(first_index, second_index);
+  }
+
+  /// Distances between the expectations of all states and query, using the
+  /// dense weighted Euclidean metric.
+  void ComputeDenseDistances(
+      const Configuration& query, Eigen::VectorXd& distances) const
+  {
+    uncertainty_planning_core::ComputeDenseDistances(
+        dense_expectations_, query, distances);
+  }
+
+  const std::vector<Configuration, ConfigAlloc>& GetExpectations() const
+  {
+    return expectations_;
+  }
+
+  const std::vector<double>& GetWeights() const { return weights_; }
+};
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <stdint.h>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <common_robotics_utilities/openmp_helpers.hpp>
+#include <uncertainty_planning_core/counter_based_prng.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
+#include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+#include <uncertainty_planning_core/simulator_decorator.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Simulator decorator that implements the batch simulations (i.e.
+/// ForwardSimulateRobots(), ReverseSimulateRobots(), and their particle-view
+/// variants) by simulating each particle with the given per-particle
+/// functions, in parallel across OpenMP threads, so that simulators only
+/// need to provide single-particle simulation. Everything else is forwarded
+/// to the wrapped simulator.
+///
+/// Particles are handed out to threads dynamically, so particles that take
+/// longer to simulate (e.g. those that make contact) do not hold up the rest
+/// of the batch. Each particle draws its noise from its own Philox4x32PRNG
+/// stream, keyed by the random stream key, the number of batches simulated
+/// since it was set, and the particle's index, so results do not depend on
+/// the number of threads or on scheduling. Inside a parallel region (e.g. in
+/// a batch of planner expansions), particles are simulated serially.
+///
+/// The particle simulation functions must be safe to call from multiple
+/// threads at once, and are shared by clones.
+template<typename Configuration, typename RNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class ParallelParticleSimulator
+    : public SimulatorDecorator<Configuration, RNG, ConfigAlloc>
+{
+public:
+  using Decorator = SimulatorDecorator<Configuration, RNG, ConfigAlloc>;
+  using Simulator = typename Decorator::Simulator;
+  using SimulatorPtr = typename Decorator::SimulatorPtr;
+  using SimulationResults = typename Decorator::SimulationResults;
+  using Robot = typename Decorator::Robot;
+  /// Simulate one particle from start_position towards target_position,
+  /// drawing any noise from particle_rng.
+  using ParticleSimulationFunction
+      = std::function<SimulationResult<Configuration>(
+          const std::shared_ptr<Robot>& immutable_robot,
+          const Configuration& start_position,
+          const Configuration& target_position, const bool allow_contacts,
+          Philox4x32PRNG& particle_rng)>;
+
+private:
+  ParticleSimulationFunction forward_simulate_particle_fn_;
+  ParticleSimulationFunction reverse_simulate_particle_fn_;
+  uint64_t batches_since_stream_key_;
+  uint64_t simulated_particles_;
+  uint64_t concurrent_batches_;
+
+  SimulationResults SimulateParticles(
+      const ParticleSimulationFunction& simulate_particle_fn,
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts)
+  {
+    // One target for every particle, or one target per particle
+    if (target_positions.Size() != 1
+        && target_positions.Size() != start_positions.Size())
+    {
+      throw std::invalid_argument(
+          "target_positions must contain 1 or start_positions.Size() "
+          "configurations");
+    }
+    const uint64_t batch_seed = MakeRandomStreamKey(
+        this->GetRandomStreamKey(), batches_since_stream_key_);
+    batches_since_stream_key_++;
+    SimulationResults results(start_positions.Size());
+    const auto simulate_particle = [&] (const size_t particle_index)
+    {
+      const Configuration& target_position
+          = (target_positions.Size() == 1)
+            ? target_positions[0] : target_positions[particle_index];
+      Philox4x32PRNG particle_rng(batch_seed, particle_index);
+      results.at(particle_index) = simulate_particle_fn(
+          immutable_robot, start_positions[particle_index], target_position,
+          allow_contacts, particle_rng);
+    };
+    const bool simulate_concurrently
+        = (start_positions.Size() > 1)
+          && !common_robotics_utilities::openmp_helpers::IsOmpInParallel();
+    if (simulate_concurrently)
+    {
+      std::vector<std::exception_ptr> particle_errors(start_positions.Size());
+      #pragma omp parallel for schedule(dynamic)
+      for (size_t idx = 0; idx < start_positions.Size(); idx++)
+      {
+        try
+        {
+          simulate_particle(idx);
+        }
+        catch (...)
+        {
+          // Exceptions cannot leave an OpenMP parallel region
+          particle_errors.at(idx) = std::current_exception();
+        }
+      }
+      for (const std::exception_ptr& particle_error : particle_errors)
+      {
+        if (particle_error)
+        {
+          std::rethrow_exception(particle_error);
+        }
+      }
+      concurrent_batches_++;
+    }
+    else
+    {
+      for (size_t idx = 0; idx < start_positions.Size(); idx++)
+      {
+        simulate_particle(idx);
+      }
+    }
+    simulated_particles_ += start_positions.Size();
+    return results;
+  }
+
+public:
+  ParallelParticleSimulator(
+      const SimulatorPtr& simulator_ptr,
+      const ParticleSimulationFunction& forward_simulate_particle_fn,
+      const ParticleSimulationFunction& reverse_simulate_particle_fn)
+      : Decorator(simulator_ptr),
+        forward_simulate_particle_fn_(forward_simulate_particle_fn),
+        reverse_simulate_particle_fn_(reverse_simulate_particle_fn),
+        batches_since_stream_key_(0u), simulated_particles_(0u),
+        concurrent_batches_(0u)
+  {
+    if (!forward_simulate_particle_fn_)
+    {
+      throw std::invalid_argument("forward_simulate_particle_fn is empty");
+    }
+    if (!reverse_simulate_particle_fn_)
+    {
+      throw std::invalid_argument("reverse_simulate_particle_fn is empty");
+    }
+  }
+
+  SimulatorPtr CloneSimulator(const uint64_t prng_seed) const override
+  {
+    const SimulatorPtr simulator_clone
+        = this->GetWrappedSimulator()->CloneSimulator(prng_seed);
+    if (!simulator_clone)
+    {
+      return SimulatorPtr();
+    }
+    return std::make_shared<ParallelParticleSimulator>(
+        simulator_clone, forward_simulate_particle_fn_,
+        reverse_simulate_particle_fn_);
+  }
+
+  void SetRandomStreamKey(const uint64_t key) override
+  {
+    Decorator::SetRandomStreamKey(key);
+    batches_since_stream_key_ = 0u;
+  }
+
+  std::map<std::string, double> GetStatistics() const override
+  {
+    std::map<std::string, double> statistics = Decorator::GetStatistics();
+    statistics["parallel_simulated_particles"]
+        = static_cast<double>(simulated_particles_);
+    statistics["parallel_concurrent_batches"]
+        = static_cast<double>(concurrent_batches_);
+    return statistics;
+  }
+
+  void ResetStatistics() override
+  {
+    Decorator::ResetStatistics();
+    simulated_particles_ = 0u;
+    concurrent_batches_ = 0u;
+  }
+
+  SimulationResults ForwardSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(display_fn);
+    return SimulateParticles(
+        forward_simulate_particle_fn_, immutable_robot,
+        ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts);
+  }
+
+  SimulationResults ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(display_fn);
+    return SimulateParticles(
+        forward_simulate_particle_fn_, immutable_robot, start_positions,
+        target_positions, allow_contacts);
+  }
+
+  SimulationResults ReverseSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(display_fn);
+    return SimulateParticles(
+        reverse_simulate_particle_fn_, immutable_robot,
+        ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts);
+  }
+
+  SimulationResults ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(display_fn);
+    return SimulateParticles(
+        reverse_simulate_particle_fn_, immutable_robot, start_positions,
+        target_positions, allow_contacts);
+  }
+};
+}  // namespace uncertainty_planning_core
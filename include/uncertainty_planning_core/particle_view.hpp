@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace uncertainty_planning_core
+{
+/// Non-owning, read-only view of a set of particles (configurations). A view
+/// either spans contiguous particles owned by someone else, or broadcasts a
+/// single configuration as if it were repeated Size() times, so that
+/// simulators can be given particles without copying them. The viewed
+/// particle(s) must outlive the view.
+template<typename Configuration>
+class ParticleView
+{
+private:
+  const Configuration* particles_;
+  size_t size_;
+  bool is_broadcast_;
+
+  ParticleView(
+      const Configuration* particles, const size_t size,
+      const bool is_broadcast)
+      : particles_(particles), size_(size), is_broadcast_(is_broadcast) {}
+
+public:
+  /// View of size contiguous particles starting at particles.
+  static ParticleView Span(const Configuration* particles, const size_t size)
+  {
+    if (particles == nullptr && size > 0)
+    {
+      throw std::invalid_argument("particles == nullptr");
+    }
+    return ParticleView(particles, size, false);
+  }
+
+  /// View of configuration repeated count times.
+  static ParticleView Broadcast(
+      const Configuration& configuration, const size_t count)
+  {
+    return ParticleView(&configuration, count, true);
+  }
+
+  template<typename ConfigAlloc>
+  static ParticleView Span(
+      const std::vector<Configuration, ConfigAlloc>& particles)
+  {
+    return Span(particles.data(), particles.size());
+  }
+
+  ParticleView() : particles_(nullptr), size_(0), is_broadcast_(false) {}
+
+  size_t Size() const { return size_; }
+
+  bool Empty() const { return size_ == 0; }
+
+  /// If true, every particle is the same configuration, so simulators can do
+  /// any per-start-configuration setup work only once.
+  bool IsBroadcast() const { return is_broadcast_; }
+
+  const Configuration& operator[](const size_t index) const
+  {
+    return is_broadcast_ ? *particles_ : particles_[index];
+  }
+
+  const Configuration& At(const size_t index) const
+  {
+    if (index >= size_)
+    {
+      throw std::out_of_range(
+          "index " + std::to_string(index) + " out of range for "
+          + std::to_string(size_) + " particles");
+    }
+    return (*this)[index];
+  }
+
+  /// Copy the viewed particles into an owning vector.
+  template<typename ConfigAlloc=std::allocator<Configuration>>
+  std::vector<Configuration, ConfigAlloc> ToVector() const
+  {
+    if (is_broadcast_)
+    {
+      return std::vector<Configuration, ConfigAlloc>(size_, *particles_);
+    }
+    else
+    {
+      return std::vector<Configuration, ConfigAlloc>(
+          particles_, particles_ + size_);
+    }
+  }
+};
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+namespace uncertainty_planning_core
+{
+/// Call count, total time, and a histogram of the durations of one phase of
+/// planning (e.g. nearest-neighbor search). Durations are binned into
+/// logarithmic buckets (four per doubling, from 1ns to ~3 days), so recording
+/// is cheap and quantiles are accurate to within ~19%. Recording is
+/// lock-free, so phases that run concurrently can share statistics.
+class PhaseTimingStatistics
+{
+public:
+  static const size_t kBucketsPerDoubling = 4u;
+  static const size_t kNumBuckets = kBucketsPerDoubling * 48u;
+
+private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_;
+  std::atomic<uint64_t> count_;
+  std::atomic<uint64_t> total_nanoseconds_;
+
+  static size_t BucketIndex(const uint64_t nanoseconds)
+  {
+    if (nanoseconds <= 1u)
+    {
+      return 0u;
+    }
+    const size_t bucket_index = static_cast<size_t>(
+        std::log2(static_cast<double>(nanoseconds))
+        * static_cast<double>(kBucketsPerDoubling));
+    return (bucket_index < kNumBuckets) ? bucket_index : (kNumBuckets - 1u);
+  }
+
+public:
+  PhaseTimingStatistics() { Reset(); }
+
+  PhaseTimingStatistics(const PhaseTimingStatistics&) = delete;
+
+  PhaseTimingStatistics& operator=(const PhaseTimingStatistics&) = delete;
+
+  void Reset()
+  {
+    for (std::atomic<uint64_t>& bucket : buckets_)
+    {
+      bucket.store(0u);
+    }
+    count_.store(0u);
+    total_nanoseconds_.store(0u);
+  }
+
+  void Record(const std::chrono::steady_clock::duration& elapsed)
+  {
+    const int64_t elapsed_nanoseconds
+        = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+            .count();
+    const uint64_t nanoseconds = (elapsed_nanoseconds > 0)
+                                 ? static_cast<uint64_t>(elapsed_nanoseconds)
+                                 : 0u;
+    buckets_[BucketIndex(nanoseconds)].fetch_add(1u);
+    count_.fetch_add(1u);
+    total_nanoseconds_.fetch_add(nanoseconds);
+  }
+
+  uint64_t Count() const { return count_.load(); }
+
+  double TotalSeconds() const
+  {
+    return static_cast<double>(total_nanoseconds_.load()) * 1e-9;
+  }
+
+  /// Estimated duration (in seconds) below which the given fraction of the
+  /// recorded durations fall, or 0 if nothing has been recorded.
+  double QuantileSeconds(const double quantile) const
+  {
+    if (quantile < 0.0 || quantile > 1.0)
+    {
+      throw std::invalid_argument("quantile must be in [0, 1]");
+    }
+    std::array<uint64_t, kNumBuckets> bucket_counts;
+    uint64_t total_count = 0u;
+    for (size_t idx = 0; idx < kNumBuckets; idx++)
+    {
+      bucket_counts[idx] = buckets_[idx].load();
+      total_count += bucket_counts[idx];
+    }
+    if (total_count == 0u)
+    {
+      return 0.0;
+    }
+    const double target_rank
+        = std::max(
+            1.0, std::ceil(quantile * static_cast<double>(total_count)));
+    uint64_t cumulative_count = 0u;
+    size_t quantile_bucket = kNumBuckets - 1u;
+    for (size_t idx = 0; idx < kNumBuckets; idx++)
+    {
+      cumulative_count += bucket_counts[idx];
+      if (static_cast<double>(cumulative_count) >= target_rank)
+      {
+        quantile_bucket = idx;
+        break;
+      }
+    }
+    // Geometric middle of the bucket
+    const double log2_nanoseconds
+        = (static_cast<double>(quantile_bucket) + 0.5)
+          / static_cast<double>(kBucketsPerDoubling);
+    return std::exp2(log2_nanoseconds) * 1e-9;
+  }
+
+  /// Adds <phase_name>_count, _time, _p50_time, and _p99_time to statistics.
+  void AddToStatistics(
+      const std::string& phase_name,
+      std::map<std::string, double>& statistics) const
+  {
+    statistics[phase_name + "_count"] = static_cast<double>(Count());
+    statistics[phase_name + "_time"] = TotalSeconds();
+    statistics[phase_name + "_p50_time"] = QuantileSeconds(0.5);
+    statistics[phase_name + "_p99_time"] = QuantileSeconds(0.99);
+  }
+};
+
+/// Records the time from construction to destruction in PhaseTimingStatistics.
+class ScopedPhaseTimer
+{
+private:
+  PhaseTimingStatistics& statistics_;
+  const std::chrono::steady_clock::time_point start_time_;
+
+public:
+  explicit ScopedPhaseTimer(PhaseTimingStatistics& statistics)
+      : statistics_(statistics),
+        start_time_(std::chrono::steady_clock::now()) {}
+
+  ScopedPhaseTimer(const ScopedPhaseTimer&) = delete;
+
+  ScopedPhaseTimer& operator=(const ScopedPhaseTimer&) = delete;
+
+  ~ScopedPhaseTimer()
+  {
+    statistics_.Record(std::chrono::steady_clock::now() - start_time_);
+  }
+};
+}  // namespace uncertainty_planning_core
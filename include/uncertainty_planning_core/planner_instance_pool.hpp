@@ -0,0 +1,182 @@
+#pragma once
+
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <common_robotics_utilities/openmp_helpers.hpp>
+#include <uncertainty_planning_core/counter_based_prng.hpp>
+#include <uncertainty_planning_core/simple_outcome_clustering_interface.hpp>
+#include <uncertainty_planning_core/simple_sampler_interface.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Per-thread simulator, clustering, and sampler instances for the planner.
+/// Instance 0 is always the primary (user-provided) instance, and the others
+/// are clones of it, so that each OpenMP thread can own one set of instances
+/// and concurrent propagations never share a simulator, clustering, or random
+/// generator. If any of the primary instances cannot be cloned, the pool only
+/// contains the primary instances.
+template<typename Configuration, typename PRNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class PlannerInstancePool
+{
+public:
+  using Sampler = SimpleSamplerInterface<Configuration, PRNG>;
+  using SamplerPtr = std::shared_ptr<Sampler>;
+  using Simulator = SimpleSimulatorInterface<Configuration, PRNG, ConfigAlloc>;
+  using SimulatorPtr = std::shared_ptr<Simulator>;
+  using Clustering
+      = SimpleOutcomeClusteringInterface<Configuration, ConfigAlloc>;
+  using ClusteringPtr = std::shared_ptr<Clustering>;
+
+private:
+  std::vector<SimulatorPtr> simulators_;
+  std::vector<ClusteringPtr> clusterings_;
+  std::vector<SamplerPtr> samplers_;
+
+  static void AddStatistics(
+      const std::map<std::string, double>& instance_statistics,
+      std::map<std::string, double>& statistics)
+  {
+    for (const auto& statistic : instance_statistics)
+    {
+      statistics[statistic.first] += statistic.second;
+    }
+  }
+
+public:
+  PlannerInstancePool(
+      const SimulatorPtr& simulator_ptr, const ClusteringPtr& clustering_ptr,
+      const SamplerPtr& sampler_ptr)
+      : simulators_(1, simulator_ptr), clusterings_(1, clustering_ptr),
+        samplers_(1, sampler_ptr) {}
+
+  size_t Size() const { return simulators_.size(); }
+
+  /// Replace any existing clones with num_instances - 1 fresh clones of the
+  /// primary instances. Clone random generators are seeded from independent
+  /// streams of prng_seed, so the clones are reproducible. Returns the
+  /// resulting size of the pool, which is 1 if the primary instances cannot be
+  /// cloned.
+  size_t Resize(const size_t num_instances, const uint64_t prng_seed)
+  {
+    if (num_instances < 1)
+    {
+      throw std::invalid_argument("num_instances < 1");
+    }
+    simulators_.resize(1);
+    clusterings_.resize(1);
+    samplers_.resize(1);
+    for (size_t idx = 1; idx < num_instances; idx++)
+    {
+      const uint64_t clone_seed = MakeRandomStreamKey(prng_seed, idx);
+      const SimulatorPtr simulator_clone
+          = simulators_.at(0)->CloneSimulator(clone_seed);
+      const ClusteringPtr clustering_clone
+          = clusterings_.at(0)->CloneClustering();
+      const SamplerPtr sampler_clone = samplers_.at(0)->CloneSampler();
+      if (!simulator_clone || !clustering_clone || !sampler_clone)
+      {
+        simulators_.resize(1);
+        clusterings_.resize(1);
+        samplers_.resize(1);
+        break;
+      }
+      simulators_.push_back(simulator_clone);
+      clusterings_.push_back(clustering_clone);
+      samplers_.push_back(sampler_clone);
+    }
+    return Size();
+  }
+
+  /// Resize the pool to one instance per OpenMP thread.
+  size_t ResizeForOmpThreads(const uint64_t prng_seed)
+  {
+    return Resize(
+        static_cast<size_t>(
+            common_robotics_utilities::openmp_helpers::GetNumOmpThreads()),
+        prng_seed);
+  }
+
+  Simulator& GetSimulator(const size_t index) const
+  {
+    return *simulators_.at(index);
+  }
+
+  Clustering& GetClustering(const size_t index) const
+  {
+    return *clusterings_.at(index);
+  }
+
+  Sampler& GetSampler(const size_t index) const
+  {
+    return *samplers_.at(index);
+  }
+
+  /// Instances owned by the calling OpenMP thread.
+  Simulator& GetThreadSimulator() const
+  {
+    return GetSimulator(GetThreadIndex());
+  }
+
+  Clustering& GetThreadClustering() const
+  {
+    return GetClustering(GetThreadIndex());
+  }
+
+  Sampler& GetThreadSampler() const
+  {
+    return GetSampler(GetThreadIndex());
+  }
+
+  size_t GetThreadIndex() const
+  {
+    const size_t thread_index = static_cast<size_t>(
+        common_robotics_utilities::openmp_helpers::GetContextOmpThreadNum());
+    if (thread_index >= Size())
+    {
+      throw std::runtime_error(
+          "No planner instances for thread " + std::to_string(thread_index));
+    }
+    return thread_index;
+  }
+
+  /// Simulator statistics, summed over all instances.
+  std::map<std::string, double> GetSimulatorStatistics() const
+  {
+    std::map<std::string, double> statistics;
+    for (const SimulatorPtr& simulator : simulators_)
+    {
+      AddStatistics(simulator->GetStatistics(), statistics);
+    }
+    return statistics;
+  }
+
+  /// Clustering statistics, summed over all instances.
+  std::map<std::string, double> GetClusteringStatistics() const
+  {
+    std::map<std::string, double> statistics;
+    for (const ClusteringPtr& clustering : clusterings_)
+    {
+      AddStatistics(clustering->GetStatistics(), statistics);
+    }
+    return statistics;
+  }
+
+  void ResetStatistics()
+  {
+    for (const SimulatorPtr& simulator : simulators_)
+    {
+      simulator->ResetStatistics();
+    }
+    for (const ClusteringPtr& clustering : clusterings_)
+    {
+      clustering->ResetStatistics();
+    }
+  }
+};
+}  // namespace uncertainty_planning_core
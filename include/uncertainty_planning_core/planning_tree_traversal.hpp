@@ -0,0 +1,110 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace uncertainty_planning_core
+{
+/// Contiguous range of child state indices.
+class ChildIndexRange
+{
+private:
+  const int64_t* begin_;
+  const int64_t* end_;
+
+public:
+  ChildIndexRange(const int64_t* begin, const int64_t* end)
+      : begin_(begin), end_(end) {}
+
+  explicit ChildIndexRange(const std::vector<int64_t>& child_indices)
+      : begin_(child_indices.data()),
+        end_(child_indices.data() + child_indices.size()) {}
+
+  const int64_t* begin() const { return begin_; }
+
+  const int64_t* end() const { return end_; }
+
+  size_t size() const { return static_cast<size_t>(end_ - begin_); }
+
+  bool empty() const { return begin_ == end_; }
+};
+
+/// Child indices of every state of a planning tree, stored in one contiguous
+/// array (i.e. compressed sparse row layout), so that traversing the whole
+/// tree does not chase a separately-allocated child list for every state.
+/// This is a snapshot, so it must be rebuilt if the tree's linkage changes.
+class PlanningTreeChildren
+{
+private:
+  std::vector<size_t> child_offsets_;
+  std::vector<int64_t> child_indices_;
+
+public:
+  template<typename PlanningTree>
+  explicit PlanningTreeChildren(const PlanningTree& tree)
+      : child_offsets_(tree.size() + 1, 0)
+  {
+    for (size_t idx = 0; idx < tree.size(); idx++)
+    {
+      child_offsets_[idx + 1]
+          = child_offsets_[idx] + tree[idx].GetChildIndices().size();
+    }
+    child_indices_.reserve(child_offsets_.back());
+    for (size_t idx = 0; idx < tree.size(); idx++)
+    {
+      const std::vector<int64_t>& child_indices = tree[idx].GetChildIndices();
+      child_indices_.insert(
+          child_indices_.end(), child_indices.begin(), child_indices.end());
+    }
+  }
+
+  size_t Size() const { return child_offsets_.size() - 1; }
+
+  ChildIndexRange GetChildIndices(const int64_t state_index) const
+  {
+    if (state_index < 0 || static_cast<size_t>(state_index) >= Size())
+    {
+      throw std::out_of_range(
+          "state_index " + std::to_string(state_index) + " out of range");
+    }
+    const int64_t* data = child_indices_.data();
+    const size_t state = static_cast<size_t>(state_index);
+    return ChildIndexRange(
+        data + child_offsets_[state], data + child_offsets_[state + 1]);
+  }
+};
+
+/// Visit the subtree rooted at root_index in depth-first pre-order, i.e. in
+/// the same order as a recursive traversal that visits children in order.
+/// Uses an explicit stack rather than recursion, so the depth of the tree
+/// (e.g. long chains of connect steps) is not limited by the call stack.
+///
+/// children_fn(state_index) returns the ChildIndexRange of a state, and
+/// visit_fn(state_index) is called for every visited state, returning true if
+/// the state's children should also be visited.
+template<typename ChildrenFunction, typename VisitFunction>
+inline void TraverseDepthFirst(
+    const int64_t root_index, const ChildrenFunction& children_fn,
+    const VisitFunction& visit_fn)
+{
+  std::vector<int64_t> stack(1, root_index);
+  while (stack.size() > 0)
+  {
+    const int64_t state_index = stack.back();
+    stack.pop_back();
+    if (visit_fn(state_index))
+    {
+      // Push children in reverse, so that they are visited in order
+      const ChildIndexRange child_indices = children_fn(state_index);
+      for (const int64_t* child_itr = child_indices.end();
+           child_itr != child_indices.begin();)
+      {
+        --child_itr;
+        stack.push_back(*child_itr);
+      }
+    }
+  }
+}
+}  // namespace uncertainty_planning_core
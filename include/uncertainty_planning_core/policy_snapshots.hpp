@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <thread>
+
+namespace uncertainty_planning_core
+{
+/// Holds the latest policy snapshot published during planning, so that an
+/// executor can poll for a new policy instead of registering a callback.
+/// Store() and Load() can be called concurrently from any threads.
+template<typename PolicyType>
+class PolicySnapshotSlot
+{
+private:
+  // Only accessed with std::atomic_load/std::atomic_store.
+  std::shared_ptr<const PolicyType> policy_;
+  std::atomic<uint64_t> version_;
+
+public:
+  PolicySnapshotSlot() : version_(0u) {}
+
+  PolicySnapshotSlot(const PolicySnapshotSlot&) = delete;
+
+  PolicySnapshotSlot& operator=(const PolicySnapshotSlot&) = delete;
+
+  void Store(const std::shared_ptr<const PolicyType>& policy)
+  {
+    std::atomic_store(&policy_, policy);
+    version_.fetch_add(1u);
+  }
+
+  /// The latest policy, or nullptr if none has been stored.
+  std::shared_ptr<const PolicyType> Load() const
+  {
+    return std::atomic_load(&policy_);
+  }
+
+  /// Number of policies stored so far, e.g. to detect a new policy.
+  uint64_t Version() const { return version_.load(); }
+};
+
+/// Runs one task at a time on a background thread, so that policy snapshots
+/// are extracted without stalling the planner. Exceptions thrown by a task
+/// are rethrown by the next call to Wait() or Start().
+class PolicySnapshotWorker
+{
+private:
+  std::thread thread_;
+  std::atomic<bool> busy_;
+  std::exception_ptr error_;
+
+public:
+  PolicySnapshotWorker() : busy_(false) {}
+
+  PolicySnapshotWorker(const PolicySnapshotWorker&) = delete;
+
+  PolicySnapshotWorker& operator=(const PolicySnapshotWorker&) = delete;
+
+  ~PolicySnapshotWorker()
+  {
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+  }
+
+  /// True while a task is running.
+  bool Busy() const { return busy_.load(); }
+
+  /// Wait for the running task (if any) to finish, then start task.
+  void Start(const std::function<void(void)>& task)
+  {
+    Wait();
+    busy_.store(true);
+    thread_ = std::thread([this, task] ()
+    {
+      try
+      {
+        task();
+      }
+      catch (...)
+      {
+        error_ = std::current_exception();
+      }
+      busy_.store(false);
+    });
+  }
+
+  /// Wait for the running task (if any) to finish.
+  void Wait()
+  {
+    if (thread_.joinable())
+    {
+      thread_.join();
+    }
+    if (error_)
+    {
+      const std::exception_ptr error = error_;
+      error_ = nullptr;
+      std::rethrow_exception(error);
+    }
+  }
+};
+}  // namespace uncertainty_planning_core
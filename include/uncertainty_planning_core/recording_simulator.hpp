@@ -0,0 +1,734 @@
+#pragma once
+
+#include <stdint.h>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <common_robotics_utilities/serialization.hpp>
+#include <uncertainty_planning_core/caching_simulator.hpp>
+#include <uncertainty_planning_core/execution_policy.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
+#include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+#include <uncertainty_planning_core/simulator_decorator.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Key of a recorded batch simulation, see SerializeSimulationInputs().
+template<typename Configuration, typename ConfigSerializer>
+inline uint64_t MakeSimulationRecordKey(
+    const bool reverse, const ParticleView<Configuration>& start_positions,
+    const ParticleView<Configuration>& target_positions,
+    const bool allow_contacts, const uint64_t random_stream_key)
+{
+  std::vector<uint8_t> key_buffer;
+  SerializeSimulationInputs<Configuration, ConfigSerializer>(
+      reverse, start_positions, target_positions, allow_contacts,
+      random_stream_key, key_buffer);
+  return HashBytes(key_buffer);
+}
+
+/// Key of a recorded collision check. Like the keys of batch simulations, it
+/// does not include the robot.
+template<typename Configuration, typename ConfigSerializer>
+inline uint64_t MakeCollisionCheckRecordKey(
+    const Configuration& config, const double inflation_ratio)
+{
+  std::vector<uint8_t> key_buffer;
+  ConfigSerializer::Serialize(config, key_buffer);
+  common_robotics_utilities::serialization::SerializeMemcpyable<double>(
+      inflation_ratio, key_buffer);
+  return HashBytes(key_buffer);
+}
+
+enum class SimulationRecordType : uint8_t
+{
+  BATCH_SIMULATION = 0,
+  COLLISION_CHECK = 1
+};
+
+// Identifies simulation recording files ("UPCSIMRC")
+const uint64_t kSimulationRecordingMagic = 0x43524d4953435055u;
+
+/// Appends a record of every batch simulation and collision check to a
+/// binary file, to be replayed by SimulationRecording. Each record is the
+/// record type, its key (which hashes the inputs), and the result. If writing
+/// a record fails, the failure is logged and recording stops, so that the
+/// run being recorded is not aborted. A recorder can be shared by simulators
+/// used from multiple threads.
+template<typename Configuration, typename ConfigSerializer>
+class SimulationRecorder
+{
+public:
+  using SimulationResults = std::vector<SimulationResult<Configuration>>;
+
+private:
+  std::mutex mutex_;
+  std::ofstream output_file_;
+  uint64_t num_records_;
+  bool is_recording_;
+  LoggingFunction logging_fn_;
+
+  void WriteRecord(const std::vector<uint8_t>& record)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!is_recording_)
+    {
+      return;
+    }
+    output_file_.write(reinterpret_cast<const char*>(record.data()),
+                       static_cast<std::streamsize>(record.size()));
+    if (output_file_.fail())
+    {
+      is_recording_ = false;
+      logging_fn_(
+          "Failed to write simulation record " + std::to_string(num_records_)
+          + ", recording stopped", 1);
+      return;
+    }
+    num_records_++;
+  }
+
+public:
+  explicit SimulationRecorder(const std::string& filepath)
+      : output_file_(filepath, std::ios::out|std::ios::binary),
+        num_records_(0u), is_recording_(true),
+        logging_fn_([] (const std::string& msg, const int32_t level)
+            { std::cout << "Log [" << level << "] : " << msg << std::endl; })
+  {
+    if (output_file_.good() == false)
+    {
+      throw std::invalid_argument(
+          "Failed to open simulation recording file " + filepath);
+    }
+    std::vector<uint8_t> header;
+    common_robotics_utilities::serialization::SerializeMemcpyable<uint64_t>(
+        kSimulationRecordingMagic, header);
+    output_file_.write(reinterpret_cast<const char*>(header.data()),
+                       static_cast<std::streamsize>(header.size()));
+  }
+
+  SimulationRecorder(const SimulationRecorder&) = delete;
+
+  SimulationRecorder& operator=(const SimulationRecorder&) = delete;
+
+  /// Must not be called while the recorder is in use.
+  void RegisterLoggingFunction(const LoggingFunction& logging_fn)
+  {
+    logging_fn_ = logging_fn;
+  }
+
+  void RecordBatchSimulation(
+      const uint64_t key, const SimulationResults& results)
+  {
+    using common_robotics_utilities::serialization::SerializeMemcpyable;
+    std::vector<uint8_t> record;
+    SerializeMemcpyable<uint8_t>(
+        static_cast<uint8_t>(SimulationRecordType::BATCH_SIMULATION), record);
+    SerializeMemcpyable<uint64_t>(key, record);
+    SerializeMemcpyable<uint64_t>(
+        static_cast<uint64_t>(results.size()), record);
+    for (const SimulationResult<Configuration>& result : results)
+    {
+      SerializeSimulationResult<Configuration, ConfigSerializer>(
+          result, record);
+    }
+    WriteRecord(record);
+  }
+
+  void RecordCollisionCheck(const uint64_t key, const bool in_collision)
+  {
+    using common_robotics_utilities::serialization::SerializeMemcpyable;
+    std::vector<uint8_t> record;
+    SerializeMemcpyable<uint8_t>(
+        static_cast<uint8_t>(SimulationRecordType::COLLISION_CHECK), record);
+    SerializeMemcpyable<uint64_t>(key, record);
+    SerializeMemcpyable<uint8_t>(static_cast<uint8_t>(in_collision), record);
+    WriteRecord(record);
+  }
+
+  uint64_t NumRecords()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return num_records_;
+  }
+
+  /// False once writing a record has failed.
+  bool IsRecording()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return is_recording_;
+  }
+
+  void Flush()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    output_file_.flush();
+  }
+};
+
+/// Records loaded from a file written by SimulationRecorder. Results are
+/// looked up by key rather than replayed in file order, so that concurrent
+/// simulations may be replayed in a different order than they were
+/// recorded. Simulations and collision checks recorded more than once with
+/// the same key are replayed in the order they were recorded, starting over
+/// once all of them have been replayed (e.g. to replay one recorded run many
+/// times). Keys do not include the robot, so a recording should only be
+/// replayed for the robot it was recorded with. A recording can be shared by
+/// simulators used from multiple threads.
+template<typename Configuration, typename ConfigSerializer>
+class SimulationRecording
+{
+public:
+  using SimulationResults = std::vector<SimulationResult<Configuration>>;
+
+private:
+  template<typename Result>
+  struct RecordedResults
+  {
+    std::vector<Result> results;
+    size_t num_replayed = 0;
+
+    const Result& Replay()
+    {
+      const size_t result_index = num_replayed % results.size();
+      num_replayed++;
+      return results.at(result_index);
+    }
+  };
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, RecordedResults<SimulationResults>>
+      batch_simulations_;
+  std::unordered_map<uint64_t, RecordedResults<uint8_t>> collision_checks_;
+
+public:
+  explicit SimulationRecording(const std::string& filepath)
+  {
+    using common_robotics_utilities::serialization::DeserializeMemcpyable;
+    std::ifstream input_file(filepath, std::ios::in|std::ios::binary);
+    if (input_file.good() == false)
+    {
+      throw std::invalid_argument(
+          "Simulation recording file " + filepath + " does not exist");
+    }
+    input_file.seekg(0, std::ios::end);
+    std::streampos end = input_file.tellg();
+    input_file.seekg(0, std::ios::beg);
+    std::streampos begin = input_file.tellg();
+    const std::streamsize serialized_size = end - begin;
+    std::vector<uint8_t> buffer(static_cast<size_t>(serialized_size), 0x00);
+    input_file.read(reinterpret_cast<char*>(buffer.data()), serialized_size);
+    uint64_t current_position = 0;
+    const auto magic_deserialized
+        = DeserializeMemcpyable<uint64_t>(buffer, current_position);
+    current_position += magic_deserialized.BytesRead();
+    if (magic_deserialized.Value() != kSimulationRecordingMagic)
+    {
+      throw std::invalid_argument(
+          filepath + " is not a simulation recording file");
+    }
+    while (current_position < buffer.size())
+    {
+      const auto type_deserialized
+          = DeserializeMemcpyable<uint8_t>(buffer, current_position);
+      current_position += type_deserialized.BytesRead();
+      const auto key_deserialized
+          = DeserializeMemcpyable<uint64_t>(buffer, current_position);
+      current_position += key_deserialized.BytesRead();
+      const SimulationRecordType type
+          = static_cast<SimulationRecordType>(type_deserialized.Value());
+      if (type == SimulationRecordType::BATCH_SIMULATION)
+      {
+        const auto size_deserialized
+            = DeserializeMemcpyable<uint64_t>(buffer, current_position);
+        current_position += size_deserialized.BytesRead();
+        SimulationResults results;
+        results.reserve(static_cast<size_t>(size_deserialized.Value()));
+        for (uint64_t idx = 0; idx < size_deserialized.Value(); idx++)
+        {
+          const auto result_deserialized
+              = DeserializeSimulationResult<Configuration, ConfigSerializer>(
+                  buffer, current_position);
+          results.push_back(result_deserialized.Value());
+          current_position += result_deserialized.BytesRead();
+        }
+        batch_simulations_[key_deserialized.Value()].results.push_back(
+            results);
+      }
+      else if (type == SimulationRecordType::COLLISION_CHECK)
+      {
+        const auto in_collision_deserialized
+            = DeserializeMemcpyable<uint8_t>(buffer, current_position);
+        current_position += in_collision_deserialized.BytesRead();
+        collision_checks_[key_deserialized.Value()].results.push_back(
+            in_collision_deserialized.Value());
+      }
+      else
+      {
+        throw std::invalid_argument(
+            "Invalid simulation record type "
+            + std::to_string(type_deserialized.Value()));
+      }
+    }
+  }
+
+  SimulationRecording(const SimulationRecording&) = delete;
+
+  SimulationRecording& operator=(const SimulationRecording&) = delete;
+
+  SimulationResults ReplayBatchSimulation(const uint64_t key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found_itr = batch_simulations_.find(key);
+    if (found_itr == batch_simulations_.end())
+    {
+      throw std::out_of_range(
+          "No batch simulation recorded with key " + std::to_string(key));
+    }
+    return found_itr->second.Replay();
+  }
+
+  bool ReplayCollisionCheck(const uint64_t key)
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    const auto found_itr = collision_checks_.find(key);
+    if (found_itr == collision_checks_.end())
+    {
+      throw std::out_of_range(
+          "No collision check recorded with key " + std::to_string(key));
+    }
+    return found_itr->second.Replay() > 0u;
+  }
+};
+
+/// Simulator decorator that records every batch simulation (i.e.
+/// ForwardSimulateRobots(), ReverseSimulateRobots(), and their particle-view
+/// variants) and collision check with a SimulationRecorder, so that they can
+/// be replayed by ReplaySimulator. Clones share the recorder.
+template<typename Configuration, typename ConfigSerializer, typename RNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class RecordingSimulator
+    : public SimulatorDecorator<Configuration, RNG, ConfigAlloc>
+{
+public:
+  using Decorator = SimulatorDecorator<Configuration, RNG, ConfigAlloc>;
+  using Simulator = typename Decorator::Simulator;
+  using SimulatorPtr = typename Decorator::SimulatorPtr;
+  using SimulationResults = typename Decorator::SimulationResults;
+  using Recorder = SimulationRecorder<Configuration, ConfigSerializer>;
+  using RecorderPtr = std::shared_ptr<Recorder>;
+
+protected:
+  using Robot = typename Decorator::Robot;
+
+private:
+  RecorderPtr recorder_ptr_;
+
+  SimulationResults RecordedSimulate(
+      const bool reverse, const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<SimulationResults(void)>& simulate_fn)
+  {
+    const uint64_t key
+        = MakeSimulationRecordKey<Configuration, ConfigSerializer>(
+            reverse, start_positions, target_positions, allow_contacts,
+            this->GetRandomStreamKey());
+    const SimulationResults results = simulate_fn();
+    recorder_ptr_->RecordBatchSimulation(key, results);
+    return results;
+  }
+
+public:
+  RecordingSimulator(
+      const SimulatorPtr& simulator_ptr, const RecorderPtr& recorder_ptr)
+      : Decorator(simulator_ptr), recorder_ptr_(recorder_ptr)
+  {
+    if (!recorder_ptr_)
+    {
+      throw std::invalid_argument("recorder_ptr is null");
+    }
+  }
+
+  const RecorderPtr& GetRecorder() const { return recorder_ptr_; }
+
+  SimulatorPtr CloneSimulator(const uint64_t prng_seed) const override
+  {
+    const SimulatorPtr simulator_clone
+        = this->GetWrappedSimulator()->CloneSimulator(prng_seed);
+    if (!simulator_clone)
+    {
+      return SimulatorPtr();
+    }
+    return std::make_shared<RecordingSimulator>(
+        simulator_clone, recorder_ptr_);
+  }
+
+  bool CheckConfigCollision(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& config,
+      const double inflation_ratio=0.0) const override
+  {
+    const bool in_collision = Decorator::CheckConfigCollision(
+        immutable_robot, config, inflation_ratio);
+    recorder_ptr_->RecordCollisionCheck(
+        MakeCollisionCheckRecordKey<Configuration, ConfigSerializer>(
+            config, inflation_ratio),
+        in_collision);
+    return in_collision;
+  }
+
+  SimulationResults ForwardSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return RecordedSimulate(
+        false, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts,
+        [&] (void)
+    {
+      return Decorator::ForwardSimulateRobots(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return RecordedSimulate(
+        false, start_positions, target_positions, allow_contacts, [&] (void)
+    {
+      return Decorator::ForwardSimulateParticles(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ReverseSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return RecordedSimulate(
+        true, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts,
+        [&] (void)
+    {
+      return Decorator::ReverseSimulateRobots(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+
+  SimulationResults ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return RecordedSimulate(
+        true, start_positions, target_positions, allow_contacts, [&] (void)
+    {
+      return Decorator::ReverseSimulateParticles(
+          immutable_robot, start_positions, target_positions, allow_contacts,
+          display_fn);
+    });
+  }
+};
+
+/// Simulator that replays a SimulationRecording instead of simulating, so
+/// that the planner's own overhead can be profiled and benchmarked without
+/// the cost of the recorded simulator. Batch simulations and collision checks
+/// are served from the recording (std::out_of_range is thrown for any that
+/// were not recorded); single-robot simulations are not supported. Display
+/// representations are empty. The random generator behaves like that of a
+/// simulator using the default SetRandomStreamKey(), so to replay a planning
+/// run, seed it as the recorded simulator's was.
+template<typename Configuration, typename ConfigSerializer, typename RNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class ReplaySimulator
+    : public SimpleSimulatorInterface<Configuration, RNG, ConfigAlloc>
+{
+public:
+  using Simulator = SimpleSimulatorInterface<Configuration, RNG, ConfigAlloc>;
+  using SimulatorPtr = std::shared_ptr<Simulator>;
+  using SimulationResults = std::vector<SimulationResult<Configuration>>;
+  using Recording = SimulationRecording<Configuration, ConfigSerializer>;
+  using RecordingPtr = std::shared_ptr<Recording>;
+
+protected:
+  using Robot = typename Simulator::Robot;
+
+private:
+  RecordingPtr recording_ptr_;
+  std::string frame_;
+  RNG rng_;
+  int32_t debug_level_;
+  uint64_t random_stream_key_;
+  uint64_t replayed_simulations_;
+
+  SimulationResults ReplaySimulate(
+      const bool reverse, const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts)
+  {
+    replayed_simulations_++;
+    return recording_ptr_->ReplayBatchSimulation(
+        MakeSimulationRecordKey<Configuration, ConfigSerializer>(
+            reverse, start_positions, target_positions, allow_contacts,
+            random_stream_key_));
+  }
+
+  [[noreturn]] static void ThrowNotReplayed(const std::string& function_name)
+  {
+    throw std::runtime_error(
+        "ReplaySimulator cannot replay " + function_name
+        + ", only batch simulations are recorded");
+  }
+
+public:
+  ReplaySimulator(
+      const RecordingPtr& recording_ptr, const std::string& frame,
+      const uint64_t prng_seed, const int32_t debug_level=0)
+      : recording_ptr_(recording_ptr), frame_(frame), rng_(prng_seed),
+        debug_level_(debug_level), random_stream_key_(0u),
+        replayed_simulations_(0u)
+  {
+    if (!recording_ptr_)
+    {
+      throw std::invalid_argument("recording_ptr is null");
+    }
+  }
+
+  int32_t GetDebugLevel() const override { return debug_level_; }
+
+  int32_t SetDebugLevel(const int32_t debug_level) override
+  {
+    debug_level_ = debug_level;
+    return debug_level_;
+  }
+
+  RNG& GetRandomGenerator() override { return rng_; }
+
+  /// Clones share the recording.
+  SimulatorPtr CloneSimulator(const uint64_t prng_seed) const override
+  {
+    return std::make_shared<ReplaySimulator>(
+        recording_ptr_, frame_, prng_seed, debug_level_);
+  }
+
+  void SetRandomStreamKey(const uint64_t key) override
+  {
+    random_stream_key_ = key;
+    rng_.seed(key);
+  }
+
+  std::string GetFrame() const override { return frame_; }
+
+  MarkerArray MakeEnvironmentDisplayRep() const override
+  {
+    return MarkerArray();
+  }
+
+  MarkerArray MakeConfigurationDisplayRep(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& configuration, const ColorRGBA& color,
+      const int32_t starting_index,
+      const std::string& config_marker_ns) const override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(configuration);
+    UNUSED(color);
+    UNUSED(starting_index);
+    UNUSED(config_marker_ns);
+    return MarkerArray();
+  }
+
+  MarkerArray MakeControlInputDisplayRep(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& configuration,
+      const Eigen::VectorXd& control_input,
+      const ColorRGBA& color, const int32_t starting_index,
+      const std::string& control_input_marker_ns) const override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(configuration);
+    UNUSED(control_input);
+    UNUSED(color);
+    UNUSED(starting_index);
+    UNUSED(control_input_marker_ns);
+    return MarkerArray();
+  }
+
+  Eigen::Vector4d Get3dPointForConfig(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& config) const override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(config);
+    return Eigen::Vector4d(0.0, 0.0, 0.0, 1.0);
+  }
+
+  std::map<std::string, double> GetStatistics() const override
+  {
+    std::map<std::string, double> statistics;
+    statistics["replayed_simulations"]
+        = static_cast<double>(replayed_simulations_);
+    return statistics;
+  }
+
+  void ResetStatistics() override { replayed_simulations_ = 0u; }
+
+  bool CheckConfigCollision(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& config,
+      const double inflation_ratio=0.0) const override
+  {
+    UNUSED(immutable_robot);
+    return recording_ptr_->ReplayCollisionCheck(
+        MakeCollisionCheckRecordKey<Configuration, ConfigSerializer>(
+            config, inflation_ratio));
+  }
+
+  SimulationResult<Configuration> ForwardSimulateMutableRobot(
+      const std::shared_ptr<Robot>& mutable_robot,
+      const Configuration& target_position, const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(mutable_robot);
+    UNUSED(target_position);
+    UNUSED(allow_contacts);
+    UNUSED(trace);
+    UNUSED(enable_tracing);
+    UNUSED(display_fn);
+    ThrowNotReplayed("ForwardSimulateMutableRobot()");
+  }
+
+  SimulationResult<Configuration> ForwardSimulateRobot(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& start_position, const Configuration& target_position,
+      const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(start_position);
+    UNUSED(target_position);
+    UNUSED(allow_contacts);
+    UNUSED(trace);
+    UNUSED(enable_tracing);
+    UNUSED(display_fn);
+    ThrowNotReplayed("ForwardSimulateRobot()");
+  }
+
+  SimulationResults ForwardSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(display_fn);
+    return ReplaySimulate(
+        false, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts);
+  }
+
+  SimulationResults ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(display_fn);
+    return ReplaySimulate(
+        false, start_positions, target_positions, allow_contacts);
+  }
+
+  SimulationResult<Configuration> ReverseSimulateMutableRobot(
+      const std::shared_ptr<Robot>& mutable_robot,
+      const Configuration& target_position, const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(mutable_robot);
+    UNUSED(target_position);
+    UNUSED(allow_contacts);
+    UNUSED(trace);
+    UNUSED(enable_tracing);
+    UNUSED(display_fn);
+    ThrowNotReplayed("ReverseSimulateMutableRobot()");
+  }
+
+  SimulationResult<Configuration> ReverseSimulateRobot(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& start_position, const Configuration& target_position,
+      const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(start_position);
+    UNUSED(target_position);
+    UNUSED(allow_contacts);
+    UNUSED(trace);
+    UNUSED(enable_tracing);
+    UNUSED(display_fn);
+    ThrowNotReplayed("ReverseSimulateRobot()");
+  }
+
+  SimulationResults ReverseSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(display_fn);
+    return ReplaySimulate(
+        true, ParticleView<Configuration>::Span(start_positions),
+        ParticleView<Configuration>::Span(target_positions), allow_contacts);
+  }
+
+  SimulationResults ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    UNUSED(immutable_robot);
+    UNUSED(display_fn);
+    return ReplaySimulate(
+        true, start_positions, target_positions, allow_contacts);
+  }
+};
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+
+namespace uncertainty_planning_core
+{
+/// Monotonic arena for the storage allocated during a planning session (e.g.
+/// the particle vectors of every state in the planning tree). Allocations are
+/// bump-allocated from large chunks, so the many small, similarly-sized
+/// allocations made while planning do not fragment the heap, and freed blocks
+/// are only reused if they were the most recent allocation in their chunk.
+/// Release() drops the arena's hold on its chunks, so that they are returned
+/// wholesale once the session's allocations have been freed.
+///
+/// Every block records the chunk it came from, and chunks are reference
+/// counted, so blocks that outlive the session (or the arena itself) remain
+/// valid and can be freed at any time from any thread. Allocation is
+/// thread-safe.
+///
+/// Allocations are only made from an arena while it is the calling thread's
+/// current arena (see SessionArenaScope); otherwise SessionArenaAllocator
+/// falls back to one heap allocation per block.
+class SessionArena
+{
+private:
+  struct Chunk
+  {
+    // One reference for each live block, plus one while the chunk is the
+    // arena's current chunk.
+    std::atomic<size_t> references;
+    // Offset of the end of the last block allocated from the chunk.
+    std::atomic<size_t> used;
+    size_t capacity;
+
+    explicit Chunk(const size_t chunk_capacity)
+        : references(1), used(0), capacity(chunk_capacity) {}
+
+    unsigned char* Data()
+    {
+      return reinterpret_cast<unsigned char*>(this) + DataOffset();
+    }
+
+    static size_t DataOffset()
+    {
+      return AlignUp(sizeof(Chunk), alignof(std::max_align_t));
+    }
+  };
+
+  // Stored immediately before every block.
+  struct BlockHeader
+  {
+    Chunk* chunk;
+    size_t start;
+  };
+
+  std::mutex mutex_;
+  Chunk* current_chunk_;
+  size_t chunk_size_;
+  size_t reserved_bytes_;
+  std::atomic<uint64_t> allocations_;
+
+  static size_t AlignUp(const size_t value, const size_t alignment)
+  {
+    return (value + alignment - 1) & ~(alignment - 1);
+  }
+
+  static Chunk* NewChunk(const size_t capacity)
+  {
+    void* memory = ::operator new(Chunk::DataOffset() + capacity);
+    return new (memory) Chunk(capacity);
+  }
+
+  static void RemoveChunkReference(Chunk* chunk)
+  {
+    if (chunk->references.fetch_sub(1) == 1)
+    {
+      chunk->~Chunk();
+      ::operator delete(static_cast<void*>(chunk));
+    }
+  }
+
+  // Try to carve a block out of the chunk, returning nullptr if it is full.
+  static void* AllocateFromChunk(
+      Chunk* chunk, const size_t bytes, const size_t alignment)
+  {
+    const uintptr_t data = reinterpret_cast<uintptr_t>(chunk->Data());
+    size_t start = chunk->used.load();
+    while (true)
+    {
+      const size_t offset
+          = AlignUp(data + start + sizeof(BlockHeader), alignment) - data;
+      const size_t end = offset + bytes;
+      if (end > chunk->capacity)
+      {
+        return nullptr;
+      }
+      // Blocks can be freed concurrently, which may roll back used.
+      if (chunk->used.compare_exchange_weak(start, end))
+      {
+        chunk->references.fetch_add(1);
+        BlockHeader* header
+            = reinterpret_cast<BlockHeader*>(chunk->Data() + offset) - 1;
+        header->chunk = chunk;
+        header->start = start;
+        return chunk->Data() + offset;
+      }
+    }
+  }
+
+  // A block in a chunk of its own, for blocks that are too large for the
+  // arena's chunks, or made without a current arena.
+  static void* AllocateDedicated(const size_t bytes, const size_t alignment)
+  {
+    Chunk* chunk = NewChunk(bytes + sizeof(BlockHeader) + alignment);
+    chunk->references.store(0);
+    return AllocateFromChunk(chunk, bytes, alignment);
+  }
+
+  static SessionArena*& ThreadCurrentArena()
+  {
+    static thread_local SessionArena* current_arena = nullptr;
+    return current_arena;
+  }
+
+public:
+  static constexpr size_t kDefaultChunkSize = 1024 * 1024;
+
+  explicit SessionArena(const size_t chunk_size = kDefaultChunkSize)
+      : current_chunk_(nullptr), chunk_size_(chunk_size), reserved_bytes_(0),
+        allocations_(0)
+  {
+    if (chunk_size_ < 1024)
+    {
+      throw std::invalid_argument("chunk_size < 1024");
+    }
+  }
+
+  SessionArena(const SessionArena&) = delete;
+
+  SessionArena& operator=(const SessionArena&) = delete;
+
+  ~SessionArena() { Release(); }
+
+  size_t ChunkSize() const { return chunk_size_; }
+
+  /// Total size of the chunks allocated by the arena since construction.
+  size_t ReservedBytes()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return reserved_bytes_;
+  }
+
+  /// Number of blocks allocated by the arena since construction. Blocks
+  /// allocated without a current arena are not counted.
+  uint64_t Allocations() const { return allocations_.load(); }
+
+  void* Allocate(const size_t bytes, const size_t alignment)
+  {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0)
+    {
+      throw std::invalid_argument("alignment must be a power of 2");
+    }
+    const size_t block_alignment = (alignment > alignof(BlockHeader))
+                                   ? alignment : alignof(BlockHeader);
+    allocations_.fetch_add(1);
+    // Large blocks would waste most of a chunk
+    if (bytes > (chunk_size_ / 4)
+        || block_alignment > alignof(std::max_align_t))
+    {
+      return AllocateDedicated(bytes, block_alignment);
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_chunk_ != nullptr)
+    {
+      void* block = AllocateFromChunk(current_chunk_, bytes, block_alignment);
+      if (block != nullptr)
+      {
+        return block;
+      }
+      RemoveChunkReference(current_chunk_);
+    }
+    current_chunk_ = NewChunk(chunk_size_);
+    reserved_bytes_ += chunk_size_;
+    return AllocateFromChunk(current_chunk_, bytes, block_alignment);
+  }
+
+  /// Free a block allocated by any arena (or by AllocateInCurrentArena).
+  /// bytes must be the size the block was allocated with.
+  static void Deallocate(void* block, const size_t bytes)
+  {
+    if (block == nullptr)
+    {
+      return;
+    }
+    const BlockHeader* header = static_cast<const BlockHeader*>(block) - 1;
+    Chunk* chunk = header->chunk;
+    // If this was the last block allocated from the chunk, reuse its space
+    const unsigned char* block_data = static_cast<unsigned char*>(block);
+    size_t end = static_cast<size_t>(block_data - chunk->Data()) + bytes;
+    chunk->used.compare_exchange_strong(end, header->start);
+    RemoveChunkReference(chunk);
+  }
+
+  /// Stop allocating from the arena's current chunk. Chunks are freed once
+  /// every block allocated from them has been freed.
+  void Release()
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (current_chunk_ != nullptr)
+    {
+      RemoveChunkReference(current_chunk_);
+      current_chunk_ = nullptr;
+    }
+  }
+
+  /// The calling thread's current arena, or nullptr.
+  static SessionArena* CurrentArena() { return ThreadCurrentArena(); }
+
+  static void* AllocateInCurrentArena(
+      const size_t bytes, const size_t alignment)
+  {
+    SessionArena* arena = CurrentArena();
+    if (arena != nullptr)
+    {
+      return arena->Allocate(bytes, alignment);
+    }
+    else
+    {
+      return AllocateDedicated(bytes, alignment);
+    }
+  }
+
+  friend class SessionArenaScope;
+};
+
+/// Makes an arena the calling thread's current arena until destruction, when
+/// the previous current arena (if any) is restored. The arena must outlive
+/// the scope.
+class SessionArenaScope
+{
+private:
+  SessionArena* previous_arena_;
+
+public:
+  explicit SessionArenaScope(SessionArena& arena)
+      : previous_arena_(SessionArena::ThreadCurrentArena())
+  {
+    SessionArena::ThreadCurrentArena() = &arena;
+  }
+
+  /// Clears the calling thread's current arena, i.e. allocations are made
+  /// from the heap.
+  explicit SessionArenaScope(std::nullptr_t)
+      : previous_arena_(SessionArena::ThreadCurrentArena())
+  {
+    SessionArena::ThreadCurrentArena() = nullptr;
+  }
+
+  SessionArenaScope(const SessionArenaScope&) = delete;
+
+  SessionArenaScope& operator=(const SessionArenaScope&) = delete;
+
+  ~SessionArenaScope()
+  {
+    SessionArena::ThreadCurrentArena() = previous_arena_;
+  }
+};
+
+/// Stateless allocator that allocates from the calling thread's current
+/// SessionArena. Since every block can be freed without knowing which arena
+/// it came from, all instances are interchangeable, so containers using it
+/// can be moved, swapped, and copied like those using std::allocator.
+template<typename T>
+class SessionArenaAllocator
+{
+public:
+  using value_type = T;
+  using propagate_on_container_move_assignment = std::true_type;
+  using is_always_equal = std::true_type;
+
+  template<typename U>
+  struct rebind
+  {
+    using other = SessionArenaAllocator<U>;
+  };
+
+  SessionArenaAllocator() noexcept {}
+
+  template<typename U>
+  SessionArenaAllocator(const SessionArenaAllocator<U>&) noexcept {}
+
+  T* allocate(const size_t n)
+  {
+    if (n > (std::numeric_limits<size_t>::max() / sizeof(T)))
+    {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(
+        SessionArena::AllocateInCurrentArena(n * sizeof(T), alignof(T)));
+  }
+
+  void deallocate(T* p, const size_t n) noexcept
+  {
+    SessionArena::Deallocate(p, n * sizeof(T));
+  }
+};
+
+template<typename T, typename U>
+inline bool operator==(
+    const SessionArenaAllocator<T>&, const SessionArenaAllocator<U>&)
+{
+  return true;
+}
+
+template<typename T, typename U>
+inline bool operator!=(
+    const SessionArenaAllocator<T>&, const SessionArenaAllocator<U>&)
+{
+  return false;
+}
+}  // namespace uncertainty_planning_core
@@ -10,6 +10,7 @@
 #include <common_robotics_utilities/simple_robot_model_interface.hpp>
 #include <uncertainty_planning_core/ros_integration.hpp>
 #include <uncertainty_planning_core/simple_simulator_interface.hpp>
+#include <uncertainty_planning_core/simulation_result_batch.hpp>
 
 namespace uncertainty_planning_core
 {
@@ -28,19 +29,32 @@ public:
 
   virtual int32_t SetDebugLevel(const int32_t debug_level) = 0;
 
+  /// Returns an independent copy of the clustering, that can be used from one
+  /// thread while this instance is used from another, or nullptr if it cannot
+  /// be copied.
+  virtual std::shared_ptr<SimpleOutcomeClusteringInterface> CloneClustering()
+      const
+  {
+    return std::shared_ptr<SimpleOutcomeClusteringInterface>();
+  }
+
   virtual std::map<std::string, double> GetStatistics() const = 0;
 
   virtual void ResetStatistics() = 0;
 
+  /// Cluster the results of simulating a batch of particles, returning the
+  /// clusters as indices into particles.
   virtual std::vector<std::vector<int64_t>> ClusterParticles(
       const std::shared_ptr<Robot>& robot,
-      const std::vector<SimulationResult<Configuration>>& particles,
+      const SimulationResultBatch<Configuration, ConfigAlloc>& particles,
       const std::function<void(const MarkerArray&)>& display_fn) = 0;
 
+  /// For each of the results in particles, identify if it is a member of
+  /// cluster (non-zero) or not (zero).
   virtual std::vector<uint8_t> IdentifyClusterMembers(
       const std::shared_ptr<Robot>& robot,
       const std::vector<Configuration, ConfigAlloc>& cluster,
-      const std::vector<SimulationResult<Configuration>>& particles,
+      const SimulationResultBatch<Configuration, ConfigAlloc>& particles,
       const std::function<void(const MarkerArray&)>& display_fn) = 0;
 };
 }  // namespace uncertainty_planning_core
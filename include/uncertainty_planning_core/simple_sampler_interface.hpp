@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+
 namespace uncertainty_planning_core
 {
 template <typename Configuration, typename Generator>
@@ -8,6 +10,14 @@ class SimpleSamplerInterface
 public:
   virtual ~SimpleSamplerInterface() {}
 
+  /// Returns an independent copy of the sampler, that can be used from one
+  /// thread while this instance is used from another, or nullptr if it cannot
+  /// be copied.
+  virtual std::shared_ptr<SimpleSamplerInterface> CloneSampler() const
+  {
+    return std::shared_ptr<SimpleSamplerInterface>();
+  }
+
   virtual Configuration Sample(Generator& prng) = 0;
 
   virtual Configuration SampleGoal(Generator& prng) = 0;
@@ -16,6 +16,8 @@
 #include <common_robotics_utilities/print.hpp>
 #include <common_robotics_utilities/conversions.hpp>
 #include <common_robotics_utilities/simple_robot_model_interface.hpp>
+#include <common_robotics_utilities/utility.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
 #include <uncertainty_planning_core/ros_integration.hpp>
 #include <omp.h>
 
@@ -107,6 +109,8 @@ public:
 
   const Configuration& ResultConfig() const { return result_config_; }
 
+  Configuration& MutableResultConfig() { return result_config_; }
+
   const Configuration& ActualTarget() const { return actual_target_; }
 
   bool DidContact() const { return did_contact_; }
@@ -149,6 +153,28 @@ public:
 
   virtual RNG& GetRandomGenerator() = 0;
 
+  /// Returns an independent copy of the simulator, with its random
+  /// generator(s) seeded from prng_seed, that can be used from one thread while
+  /// this instance is used from another. Simulators that cannot be copied
+  /// return nullptr, in which case the planner only simulates from one thread.
+  virtual std::shared_ptr<SimpleSimulatorInterface> CloneSimulator(
+      const uint64_t prng_seed) const
+  {
+    UNUSED(prng_seed);
+    return std::shared_ptr<SimpleSimulatorInterface>();
+  }
+
+  /// Called by the planner before it forward or reverse simulates particles,
+  /// with a key that is unique to the transition being simulated, and does not
+  /// depend on thread count or scheduling. Simulators
+  /// that draw the noise for each particle from Philox4x32PRNG(key, particle
+  /// index) give reproducible results even if particles are simulated in
+  /// parallel. By default, this reseeds the random generator.
+  virtual void SetRandomStreamKey(const uint64_t key)
+  {
+    GetRandomGenerator().seed(key);
+  }
+
   virtual std::string GetFrame() const = 0;
 
   virtual MarkerArray MakeEnvironmentDisplayRep() const = 0;
@@ -200,6 +226,25 @@ public:
       const bool allow_contacts,
       const std::function<void(const MarkerArray&)>& display_fn) = 0;
 
+  /// Same as ForwardSimulateRobots(), but takes non-owning views of the start
+  /// and target positions, so callers do not need to copy particles into
+  /// vectors. Simulators can override this to skip those copies entirely, and
+  /// to only do per-start setup work once if start_positions is a broadcast of
+  /// a single configuration. By default, the views are copied into vectors.
+  virtual std::vector<SimulationResult<Configuration>>
+  ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn)
+  {
+    return ForwardSimulateRobots(
+        immutable_robot, start_positions.template ToVector<ConfigAlloc>(),
+        target_positions.template ToVector<ConfigAlloc>(), allow_contacts,
+        display_fn);
+  }
+
   virtual SimulationResult<Configuration> ReverseSimulateMutableRobot(
       const std::shared_ptr<Robot>& mutable_robot,
       const Configuration& target_position, const bool allow_contacts,
@@ -221,6 +266,22 @@ public:
       const std::vector<Configuration, ConfigAlloc>& target_positions,
       const bool allow_contacts,
       const std::function<void(const MarkerArray&)>& display_fn) = 0;
+
+  /// Same as ReverseSimulateRobots(), but takes non-owning views of the start
+  /// and target positions, see ForwardSimulateParticles().
+  virtual std::vector<SimulationResult<Configuration>>
+  ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn)
+  {
+    return ReverseSimulateRobots(
+        immutable_robot, start_positions.template ToVector<ConfigAlloc>(),
+        target_positions.template ToVector<ConfigAlloc>(), allow_contacts,
+        display_fn);
+  }
 };
 
 template<typename Configuration>
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include <common_robotics_utilities/math.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Results of simulating a batch of particles towards the same target, stored
+/// as a structure of arrays: the result configurations are contiguous, the
+/// actual target is stored once for the whole batch, and the per-particle
+/// contact and nominal independence flags are stored as bitsets. Compared to
+/// a std::vector<SimulationResult>, walking the result configurations (e.g.
+/// in outcome clustering) touches only the configurations themselves.
+template<typename Configuration,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class SimulationResultBatch
+{
+private:
+  std::vector<Configuration, ConfigAlloc> result_configs_;
+  Configuration actual_target_;
+  std::vector<bool> did_contact_;
+  std::vector<bool> outcome_is_nominally_independent_;
+
+  void CheckIndex(const size_t index) const
+  {
+    if (index >= result_configs_.size())
+    {
+      throw std::out_of_range(
+          "index " + std::to_string(index) + " out of range for "
+          + std::to_string(result_configs_.size()) + " results");
+    }
+  }
+
+public:
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  /// Make a batch from the results of simulating particles towards the same
+  /// target (e.g. the results of ForwardSimulateParticles() with a single
+  /// target), moving their result configurations. Since every result has the
+  /// same actual target, only the actual target of the first is kept.
+  static SimulationResultBatch FromResults(
+      std::vector<SimulationResult<Configuration>> results)
+  {
+    SimulationResultBatch batch;
+    if (results.empty())
+    {
+      return batch;
+    }
+    batch.actual_target_ = results.front().ActualTarget();
+    batch.Reserve(results.size());
+    for (SimulationResult<Configuration>& result : results)
+    {
+      batch.AddResult(
+          std::move(result.MutableResultConfig()), result.DidContact(),
+          result.OutcomeIsNominallyIndependent());
+    }
+    return batch;
+  }
+
+  SimulationResultBatch() {}
+
+  explicit SimulationResultBatch(const Configuration& actual_target)
+      : actual_target_(actual_target) {}
+
+  void Reserve(const size_t num_results)
+  {
+    result_configs_.reserve(num_results);
+    did_contact_.reserve(num_results);
+    outcome_is_nominally_independent_.reserve(num_results);
+  }
+
+  void AddResult(
+      Configuration result_config, const bool did_contact,
+      const bool outcome_is_nominally_independent)
+  {
+    result_configs_.push_back(std::move(result_config));
+    did_contact_.push_back(did_contact);
+    outcome_is_nominally_independent_.push_back(
+        outcome_is_nominally_independent);
+  }
+
+  size_t Size() const { return result_configs_.size(); }
+
+  bool Empty() const { return result_configs_.empty(); }
+
+  const std::vector<Configuration, ConfigAlloc>& ResultConfigs() const
+  {
+    return result_configs_;
+  }
+
+  ParticleView<Configuration> ViewResultConfigs() const
+  {
+    return ParticleView<Configuration>::Span(result_configs_);
+  }
+
+  const Configuration& ResultConfig(const size_t index) const
+  {
+    return result_configs_.at(index);
+  }
+
+  Configuration& MutableResultConfig(const size_t index)
+  {
+    return result_configs_.at(index);
+  }
+
+  const Configuration& ActualTarget() const { return actual_target_; }
+
+  bool DidContact(const size_t index) const
+  {
+    CheckIndex(index);
+    return did_contact_[index];
+  }
+
+  bool OutcomeIsNominallyIndependent(const size_t index) const
+  {
+    CheckIndex(index);
+    return outcome_is_nominally_independent_[index];
+  }
+
+  /// Copy the result of a single particle out of the batch.
+  SimulationResult<Configuration> GetResult(const size_t index) const
+  {
+    return SimulationResult<Configuration>(
+        ResultConfig(index), actual_target_, DidContact(index),
+        OutcomeIsNominallyIndependent(index));
+  }
+};
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,226 @@
+#pragma once
+
+#include <stdint.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <uncertainty_planning_core/particle_view.hpp>
+#include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/simple_simulator_interface.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Base for simulators that wrap another simulator (e.g. CachingSimulator),
+/// forwarding every call to it, so that decorators only need to override the
+/// calls they change. The last random stream key set is kept, since it is
+/// part of what the results of a simulation depend on. Decorators that can
+/// be cloned must override CloneSimulator() to wrap a clone of the wrapped
+/// simulator; by default, they cannot be cloned.
+template<typename Configuration, typename RNG,
+         typename ConfigAlloc=std::allocator<Configuration>>
+class SimulatorDecorator
+    : public SimpleSimulatorInterface<Configuration, RNG, ConfigAlloc>
+{
+public:
+  using Simulator = SimpleSimulatorInterface<Configuration, RNG, ConfigAlloc>;
+  using SimulatorPtr = std::shared_ptr<Simulator>;
+  using SimulationResults = std::vector<SimulationResult<Configuration>>;
+
+protected:
+  using Robot = typename Simulator::Robot;
+
+private:
+  SimulatorPtr simulator_ptr_;
+  uint64_t random_stream_key_;
+
+public:
+  explicit SimulatorDecorator(const SimulatorPtr& simulator_ptr)
+      : simulator_ptr_(simulator_ptr), random_stream_key_(0u)
+  {
+    if (!simulator_ptr_)
+    {
+      throw std::invalid_argument("simulator_ptr is null");
+    }
+  }
+
+  const SimulatorPtr& GetWrappedSimulator() const { return simulator_ptr_; }
+
+  /// The last key passed to SetRandomStreamKey(), or 0 if none has been.
+  uint64_t GetRandomStreamKey() const { return random_stream_key_; }
+
+  int32_t GetDebugLevel() const override
+  {
+    return simulator_ptr_->GetDebugLevel();
+  }
+
+  int32_t SetDebugLevel(const int32_t debug_level) override
+  {
+    return simulator_ptr_->SetDebugLevel(debug_level);
+  }
+
+  RNG& GetRandomGenerator() override
+  {
+    return simulator_ptr_->GetRandomGenerator();
+  }
+
+  void SetRandomStreamKey(const uint64_t key) override
+  {
+    random_stream_key_ = key;
+    simulator_ptr_->SetRandomStreamKey(key);
+  }
+
+  std::string GetFrame() const override { return simulator_ptr_->GetFrame(); }
+
+  MarkerArray MakeEnvironmentDisplayRep() const override
+  {
+    return simulator_ptr_->MakeEnvironmentDisplayRep();
+  }
+
+  MarkerArray MakeConfigurationDisplayRep(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& configuration, const ColorRGBA& color,
+      const int32_t starting_index,
+      const std::string& config_marker_ns) const override
+  {
+    return simulator_ptr_->MakeConfigurationDisplayRep(
+        immutable_robot, configuration, color, starting_index,
+        config_marker_ns);
+  }
+
+  MarkerArray MakeControlInputDisplayRep(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& configuration,
+      const Eigen::VectorXd& control_input,
+      const ColorRGBA& color, const int32_t starting_index,
+      const std::string& control_input_marker_ns) const override
+  {
+    return simulator_ptr_->MakeControlInputDisplayRep(
+        immutable_robot, configuration, control_input, color, starting_index,
+        control_input_marker_ns);
+  }
+
+  Eigen::Vector4d Get3dPointForConfig(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& config) const override
+  {
+    return simulator_ptr_->Get3dPointForConfig(immutable_robot, config);
+  }
+
+  std::map<std::string, double> GetStatistics() const override
+  {
+    return simulator_ptr_->GetStatistics();
+  }
+
+  void ResetStatistics() override { simulator_ptr_->ResetStatistics(); }
+
+  bool CheckConfigCollision(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& config,
+      const double inflation_ratio=0.0) const override
+  {
+    return simulator_ptr_->CheckConfigCollision(
+        immutable_robot, config, inflation_ratio);
+  }
+
+  SimulationResult<Configuration> ForwardSimulateMutableRobot(
+      const std::shared_ptr<Robot>& mutable_robot,
+      const Configuration& target_position, const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ForwardSimulateMutableRobot(
+        mutable_robot, target_position, allow_contacts, trace, enable_tracing,
+        display_fn);
+  }
+
+  SimulationResult<Configuration> ForwardSimulateRobot(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& start_position, const Configuration& target_position,
+      const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ForwardSimulateRobot(
+        immutable_robot, start_position, target_position, allow_contacts,
+        trace, enable_tracing, display_fn);
+  }
+
+  SimulationResults ForwardSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ForwardSimulateRobots(
+        immutable_robot, start_positions, target_positions, allow_contacts,
+        display_fn);
+  }
+
+  SimulationResults ForwardSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ForwardSimulateParticles(
+        immutable_robot, start_positions, target_positions, allow_contacts,
+        display_fn);
+  }
+
+  SimulationResult<Configuration> ReverseSimulateMutableRobot(
+      const std::shared_ptr<Robot>& mutable_robot,
+      const Configuration& target_position, const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ReverseSimulateMutableRobot(
+        mutable_robot, target_position, allow_contacts, trace, enable_tracing,
+        display_fn);
+  }
+
+  SimulationResult<Configuration> ReverseSimulateRobot(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const Configuration& start_position, const Configuration& target_position,
+      const bool allow_contacts,
+      ForwardSimulationStepTrace<Configuration, ConfigAlloc>& trace,
+      const bool enable_tracing,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ReverseSimulateRobot(
+        immutable_robot, start_position, target_position, allow_contacts,
+        trace, enable_tracing, display_fn);
+  }
+
+  SimulationResults ReverseSimulateRobots(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const std::vector<Configuration, ConfigAlloc>& start_positions,
+      const std::vector<Configuration, ConfigAlloc>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ReverseSimulateRobots(
+        immutable_robot, start_positions, target_positions, allow_contacts,
+        display_fn);
+  }
+
+  SimulationResults ReverseSimulateParticles(
+      const std::shared_ptr<Robot>& immutable_robot,
+      const ParticleView<Configuration>& start_positions,
+      const ParticleView<Configuration>& target_positions,
+      const bool allow_contacts,
+      const std::function<void(const MarkerArray&)>& display_fn) override
+  {
+    return simulator_ptr_->ReverseSimulateParticles(
+        immutable_robot, start_positions, target_positions, allow_contacts,
+        display_fn);
+  }
+};
+}  // namespace uncertainty_planning_core
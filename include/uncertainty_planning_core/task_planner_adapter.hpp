@@ -381,13 +381,29 @@ private:
     }
   }
 
+  // Clustering only looks at result configurations, so it works on either
+  // simulation results or result configurations (e.g. of a
+  // SimulationResultBatch) without copying them.
+  static const State& GetResultConfig(
+      const std::vector<SimulationResult<State>>& particles, const size_t idx)
+  {
+    return particles.at(idx).ResultConfig();
+  }
+
+  static const State& GetResultConfig(
+      const std::vector<State, StateAlloc>& particles, const size_t idx)
+  {
+    return particles.at(idx);
+  }
+
+  template<typename Particles>
   std::vector<std::vector<int64_t>> ClusterParticlesImpl(
-      const std::vector<SimulationResult<State>>& particles)
+      const Particles& particles)
   {
     std::map<uint64_t, std::vector<int64_t>> cluster_map;
     for (size_t idx = 0; idx < particles.size(); idx++)
     {
-      const State& config = particles.at(idx).ResultConfig();
+      const State& config = GetResultConfig(particles, idx);
       const uint64_t particle_readiness
           = ComputeStateReadiness(config);
       cluster_map[particle_readiness].push_back(static_cast<int64_t>(idx));
@@ -400,9 +416,10 @@ private:
     return clusters;
   }
 
+  template<typename Particles>
   std::vector<uint8_t> IdentifyClusterMembersImpl(
       const std::vector<State, StateAlloc>& cluster,
-      const std::vector<SimulationResult<State>>& particles)
+      const Particles& particles)
   {
     if (cluster.size() > 0)
     {
@@ -420,7 +437,7 @@ private:
       std::vector<uint8_t> particle_cluster_membership(particles.size(), 0x00);
       for (size_t idx = 0; idx < particles.size(); idx++)
       {
-        const State& config = particles.at(idx).ResultConfig();
+        const State& config = GetResultConfig(particles, idx);
         const uint64_t particle_readiness
             = ComputeStateReadiness(config);
         if (parent_cluster_readiness == particle_readiness)
@@ -1127,9 +1144,7 @@ public:
         = [&] (const std::vector<State, StateAlloc>& particles,
                const State& result_state)
     {
-      std::vector<SimulationResult<State>> result_particles;
-      result_particles.emplace_back(
-            SimulationResult<State>(result_state, result_state, false, false));
+      const std::vector<State, StateAlloc> result_particles(1, result_state);
       const std::vector<uint8_t> cluster_membership
           = IdentifyClusterMembersImpl(particles, result_particles);
       const uint8_t parent_cluster_membership = cluster_membership.at(0);
@@ -1426,23 +1441,23 @@ public:
 
   virtual std::vector<std::vector<int64_t>> ClusterParticles(
     const TaskStateRobotBasePtr& robot,
-    const std::vector<SimulationResult<State>>& particles,
+    const SimulationResultBatch<State, StateAlloc>& particles,
     const DisplayFunction& display_fn)
   {
     UNUSED(robot);
     UNUSED(display_fn);
-    return ClusterParticlesImpl(particles);
+    return ClusterParticlesImpl(particles.ResultConfigs());
   }
 
   virtual std::vector<uint8_t> IdentifyClusterMembers(
     const TaskStateRobotBasePtr& robot,
     const std::vector<State, StateAlloc>& cluster,
-    const std::vector<SimulationResult<State>>& particles,
+    const SimulationResultBatch<State, StateAlloc>& particles,
     const DisplayFunction& display_fn)
   {
     UNUSED(robot);
     UNUSED(display_fn);
-    return IdentifyClusterMembersImpl(cluster, particles);
+    return IdentifyClusterMembersImpl(cluster, particles.ResultConfigs());
   }
 
   virtual State Sample(uncertainty_planning_core::PRNG& prng)
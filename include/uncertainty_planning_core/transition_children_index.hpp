@@ -0,0 +1,140 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace uncertainty_planning_core
+{
+/// Children of a planning tree state that result from the same transition
+/// (i.e. the same action). Transitions that split have more than one child.
+class TransitionChildren
+{
+private:
+  uint64_t transition_id_;
+  std::vector<int64_t> child_indices_;
+
+public:
+  TransitionChildren(const uint64_t transition_id, const int64_t child_index)
+      : transition_id_(transition_id), child_indices_(1, child_index) {}
+
+  uint64_t TransitionId() const { return transition_id_; }
+
+  const std::vector<int64_t>& ChildIndices() const { return child_indices_; }
+
+  void AddChildIndex(const int64_t child_index)
+  {
+    child_indices_.push_back(child_index);
+  }
+};
+
+/// Persistent index of the children of every state in a planning tree,
+/// grouped by transition ID, so that split outcomes can be found without
+/// regrouping a state's children every time it is updated. Transitions are
+/// kept in the order their first child was added.
+///
+/// The index is updated incrementally by Update(), which only indexes states
+/// appended to the tree since the last update, so the parent and transition
+/// ID of a state must not change after it has been indexed. If a tree is
+/// modified in any other way, or replaced, the index must be cleared (or
+/// rebuilt).
+class TransitionChildrenIndex
+{
+private:
+  std::vector<std::vector<TransitionChildren>> transitions_;
+  size_t num_indexed_states_ = 0;
+
+  void CheckStateIndex(const int64_t state_index) const
+  {
+    if (state_index < 0
+        || static_cast<size_t>(state_index) >= transitions_.size())
+    {
+      throw std::out_of_range(
+          "state_index " + std::to_string(state_index) + " is not indexed");
+    }
+  }
+
+public:
+  size_t Size() const { return num_indexed_states_; }
+
+  void Clear()
+  {
+    transitions_.clear();
+    num_indexed_states_ = 0;
+  }
+
+  /// Index the states appended to tree since the last update. If the tree
+  /// has fewer states than are indexed, it must have been replaced, so the
+  /// index is rebuilt from scratch.
+  template<typename PlanningTree>
+  void Update(const PlanningTree& tree)
+  {
+    if (tree.size() < num_indexed_states_)
+    {
+      Clear();
+    }
+    transitions_.resize(tree.size());
+    for (size_t idx = num_indexed_states_; idx < tree.size(); idx++)
+    {
+      const int64_t parent_index = tree[idx].GetParentIndex();
+      // Roots (and states pruned from the tree) have no parent
+      if (parent_index >= 0)
+      {
+        AddChild(
+            parent_index, static_cast<int64_t>(idx),
+            tree[idx].GetValueImmutable().GetTransitionId());
+      }
+    }
+    num_indexed_states_ = tree.size();
+  }
+
+  template<typename PlanningTree>
+  void Rebuild(const PlanningTree& tree)
+  {
+    Clear();
+    Update(tree);
+  }
+
+  void AddChild(
+      const int64_t parent_index, const int64_t child_index,
+      const uint64_t transition_id)
+  {
+    CheckStateIndex(parent_index);
+    std::vector<TransitionChildren>& parent_transitions
+        = transitions_[static_cast<size_t>(parent_index)];
+    for (TransitionChildren& transition : parent_transitions)
+    {
+      if (transition.TransitionId() == transition_id)
+      {
+        transition.AddChildIndex(child_index);
+        return;
+      }
+    }
+    parent_transitions.emplace_back(transition_id, child_index);
+  }
+
+  const std::vector<TransitionChildren>& GetTransitions(
+      const int64_t state_index) const
+  {
+    CheckStateIndex(state_index);
+    return transitions_[static_cast<size_t>(state_index)];
+  }
+
+  /// Children of the state with the given transition ID.
+  const std::vector<int64_t>& GetTransitionChildIndices(
+      const int64_t state_index, const uint64_t transition_id) const
+  {
+    for (const TransitionChildren& transition : GetTransitions(state_index))
+    {
+      if (transition.TransitionId() == transition_id)
+      {
+        return transition.ChildIndices();
+      }
+    }
+    throw std::invalid_argument(
+        "State " + std::to_string(state_index) + " has no children with "
+        "transition ID " + std::to_string(transition_id));
+  }
+};
+}  // namespace uncertainty_planning_core
@@ -4,18 +4,24 @@
 #include <stdio.h>
 #include <vector>
 #include <string>
+#include <map>
+#include <algorithm>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <stdexcept>
 #include <functional>
+#include <exception>
 #include <chrono>
 #include <random>
 #include <mutex>
 #include <thread>
 #include <atomic>
+#include <deque>
+#include <utility>
 #include <common_robotics_utilities/color_builder.hpp>
 #include <common_robotics_utilities/math.hpp>
+#include <common_robotics_utilities/openmp_helpers.hpp>
 #include <common_robotics_utilities/zlib_helpers.hpp>
 #include <common_robotics_utilities/math.hpp>
 #include <common_robotics_utilities/ros_conversions.hpp>
@@ -28,11 +34,53 @@
 #include <uncertainty_planning_core/uncertainty_planner_state.hpp>
 #include <uncertainty_planning_core/simple_simulator_interface.hpp>
 #include <uncertainty_planning_core/execution_policy.hpp>
+#include <uncertainty_planning_core/batched_rrt_planner.hpp>
+#include <uncertainty_planning_core/counter_based_prng.hpp>
+#include <uncertainty_planning_core/phase_timing_statistics.hpp>
+#include <uncertainty_planning_core/nearest_neighbors_cache.hpp>
+#include <uncertainty_planning_core/planner_instance_pool.hpp>
+#include <uncertainty_planning_core/planning_tree_traversal.hpp>
+#include <uncertainty_planning_core/policy_snapshots.hpp>
+#include <uncertainty_planning_core/session_arena_allocator.hpp>
+#include <uncertainty_planning_core/simulation_result_batch.hpp>
+#include <uncertainty_planning_core/transition_children_index.hpp>
+#include <uncertainty_planning_core/vantage_point_tree.hpp>
+#include <uncertainty_planning_core/weighted_euclidean_distance.hpp>
 #include <common_robotics_utilities/conversions.hpp>
 #include <omp.h>
 
 namespace uncertainty_planning_core
 {
+/// Why the planner stopped expanding the planning tree. NO_EXPANDABLE_STATES
+/// means that every state in the tree has been blacklisted.
+enum class PlannerTerminationReason : uint8_t
+{
+  NOT_TERMINATED = 0x00,
+  TIME_LIMIT = 0x01,
+  GOAL_PROBABILITY_THRESHOLD = 0x02,
+  GOAL_PROBABILITY_CONVERGED = 0x03,
+  NO_EXPANDABLE_STATES = 0x04
+};
+
+inline std::string PlannerTerminationReasonToString(
+    const PlannerTerminationReason reason)
+{
+  switch (reason)
+  {
+    case PlannerTerminationReason::NOT_TERMINATED:
+      return "not terminated";
+    case PlannerTerminationReason::TIME_LIMIT:
+      return "time limit";
+    case PlannerTerminationReason::GOAL_PROBABILITY_THRESHOLD:
+      return "goal probability threshold";
+    case PlannerTerminationReason::GOAL_PROBABILITY_CONVERGED:
+      return "goal probability converged";
+    case PlannerTerminationReason::NO_EXPANDABLE_STATES:
+      return "no expandable states";
+  }
+  throw std::invalid_argument("Invalid PlannerTerminationReason");
+}
+
 template<typename Configuration,
          typename ConfigAlloc=std::allocator<Configuration>>
 using PolicyActionExecutionFunction
@@ -59,6 +107,11 @@ public:
       const PolicyPlanningStatistics& statistics)
       : policy_(policy), statistics_(statistics) {}
 
+  UncertaintyPolicyPlanningResult(
+      ExecutionPolicyType&& policy,
+      const PolicyPlanningStatistics& statistics)
+      : policy_(std::move(policy)), statistics_(statistics) {}
+
   explicit UncertaintyPolicyPlanningResult(
       const PolicyPlanningStatistics& statistics)
       : statistics_(statistics) {}
@@ -321,83 +374,114 @@ protected:
       = common_robotics_utilities::simple_rrt_planner
           ::RRTForwardPropagationFunction<
               UncertaintyPlanningState, UncertaintyPlanningState>;
+  using UncertaintyPlanningIndexedForwardPropagationFunction
+      = IndexedRRTForwardPropagationFunction<
+          UncertaintyPlanningState, UncertaintyPlanningState>;
   using UncertaintyPlanningNearestNeighborFunction
       = std::function<int64_t(
           const UncertaintyPlanningTree&, const UncertaintyPlanningState&)>;
   using StateDistanceFunction
       = std::function<double(
           const UncertaintyPlanningState&, const UncertaintyPlanningState&)>;
+  using PolicySnapshotCallback
+      = std::function<void(
+          const std::shared_ptr<const UncertaintyPlanningPolicy>&,
+          const double)>;
+
+  // P(goal reached) after a planner iteration, with the amount of work done
+  // so far, to measure how quickly P(goal reached) is improving.
+  struct ConvergenceSample
+  {
+    uint64_t iteration;
+    uint64_t particles_simulated;
+    double goal_reached_probability;
+  };
+
+  // A reverse edge check deferred by lazy reverse edge evaluation. Until the
+  // state is added to the planning tree, its reverse target (the state it was
+  // propagated from) is not known yet, and is -1.
+  struct DeferredReverseEdgeCheck
+  {
+    int64_t reverse_target_index;
+    uint64_t random_stream_key;
+  };
+
+  // Key of the random stream used to sample virtual goals for snapshots.
+  static const uint64_t kPolicySnapshotGoalStream = ~static_cast<uint64_t>(0);
 
   // Helper classes
   class SimulateParticlesResult
   {
   private:
-    ConfigVector initial_particles_;
-    std::vector<SimulationResult<Configuration>> simulated_particles_;
+    SimulationResultBatch<Configuration, ConfigAlloc> simulated_particles_;
 
   public:
-    SimulateParticlesResult(
-        const ConfigVector& initial_particles,
-        const std::vector<SimulationResult<Configuration>>& simulated_particles)
-        : initial_particles_(initial_particles),
-          simulated_particles_(simulated_particles) {}
-
-    const ConfigVector& InitialParticles() const { return initial_particles_; }
+    explicit SimulateParticlesResult(
+        SimulationResultBatch<Configuration, ConfigAlloc> simulated_particles)
+        : simulated_particles_(std::move(simulated_particles)) {}
 
-    const std::vector<SimulationResult<Configuration>>&
+    const SimulationResultBatch<Configuration, ConfigAlloc>&
     SimulatedParticles() const { return simulated_particles_; }
+
+    SimulationResultBatch<Configuration, ConfigAlloc>&
+    MutableSimulatedParticles() { return simulated_particles_; }
   };
 
-  class ForwardSimulateStatesResult
+  // Provisional IDs and random streams for a single expansion of the tree.
+  // Expansions may be propagated concurrently, so IDs are assigned from a
+  // per-expansion counter, with the (1-based) expansion ID in the high bits,
+  // and replaced with sequential IDs when states are added to the tree (see
+  // FinalizeStateIds). Provisional IDs have kProvisionalIdFlag set, so they
+  // cannot be mistaken for final IDs, however large. Random streams are keyed
+  // by these provisional IDs, so they only depend on the planner seed and the
+  // order samples are drawn in.
+  class ExpansionContext
   {
   private:
-    UncertaintyPlanningStateForwardPropagation forward_propagation_;
-    SimulateParticlesResult particle_simulations_;
+    uint64_t random_seed_;
+    uint64_t expansion_id_;
+    uint64_t num_ids_;
 
   public:
-    ForwardSimulateStatesResult(
-        const UncertaintyPlanningStateForwardPropagation& forward_propagation,
-        const SimulateParticlesResult particle_simulations)
-        : forward_propagation_(forward_propagation),
-          particle_simulations_(particle_simulations) {}
-
-    const UncertaintyPlanningStateForwardPropagation&
-    ForwardPropagation() const { return forward_propagation_; }
+    static const uint32_t kLocalIdBits = 24u;
+    static const uint64_t kProvisionalIdFlag = static_cast<uint64_t>(1u) << 63;
 
-    const SimulateParticlesResult&
-    ParticleSimulations() const { return particle_simulations_; }
-  };
-
-  class PerformForwardPropagationResult
-  {
-  private:
-    UncertaintyPlanningStateForwardPropagation combined_forward_propagations_;
-    std::vector<SimulateParticlesResult> step_particle_simulations_;
+    ExpansionContext(const uint64_t random_seed, const int64_t expansion_index)
+        : random_seed_(random_seed),
+          expansion_id_(static_cast<uint64_t>(expansion_index) + 1u),
+          num_ids_(0u) {}
 
-  public:
-    PerformForwardPropagationResult(
-        const UncertaintyPlanningStateForwardPropagation&
-            combined_forward_propagations,
-        const std::vector<SimulateParticlesResult>& step_particle_simulations)
-        : combined_forward_propagations_(combined_forward_propagations),
-          step_particle_simulations_(step_particle_simulations) {}
+    /// Expansion ID of the given provisional ID, or 0 if it is not one.
+    static uint64_t GetExpansionId(const uint64_t provisional_id)
+    {
+      if ((provisional_id & kProvisionalIdFlag) == 0)
+      {
+        return 0u;
+      }
+      return (provisional_id & ~kProvisionalIdFlag) >> kLocalIdBits;
+    }
 
-    explicit PerformForwardPropagationResult(
-        const ForwardSimulateStatesResult& forward_simulation_result)
-        : combined_forward_propagations_(
-              forward_simulation_result.ForwardPropagation()),
-          step_particle_simulations_(
-              {forward_simulation_result.ParticleSimulations()}) {}
+    uint64_t NextId()
+    {
+      num_ids_++;
+      if (num_ids_ >= (static_cast<uint64_t>(1u) << kLocalIdBits))
+      {
+        throw std::runtime_error("Too many IDs for a single expansion");
+      }
+      return kProvisionalIdFlag | (expansion_id_ << kLocalIdBits) | num_ids_;
+    }
 
-    const UncertaintyPlanningStateForwardPropagation&
-    CombinedForwardPropagations() const
+    /// Key for random streams of the given provisional (transition) ID.
+    uint64_t GetRandomStreamKey(const uint64_t provisional_id) const
     {
-      return combined_forward_propagations_;
+      return MakeRandomStreamKey(
+          random_seed_, provisional_id & ~kProvisionalIdFlag);
     }
 
-    const std::vector<SimulateParticlesResult>& StepParticleSimulations() const
+    /// Random stream for decisions made once per expansion.
+    Philox4x32PRNG MakeExpansionRandomStream() const
     {
-      return step_particle_simulations_;
+      return Philox4x32PRNG(random_seed_, expansion_id_ << kLocalIdBits);
     }
   };
 
@@ -409,35 +493,115 @@ protected:
   double feasibility_alpha_;
   double variance_alpha_;
   double connect_after_first_solution_;
+  ParticleResamplingMethod particle_resampling_method_;
   int32_t debug_level_;
   RobotPtr robot_ptr_;
   SamplerPtr sampler_ptr_;
   SimulatorPtr simulator_ptr_;
   ClusteringPtr clustering_ptr_;
+  PlannerInstancePool<Configuration, PRNG, ConfigAlloc> instance_pool_;
+  // State, transition, and split IDs are only assigned serially, when states
+  // are merged into the planning tree (see FinalizeStateIds()). Counters that
+  // are modified during forward propagation are atomic, since batched
+  // expansion runs several propagations concurrently.
   uint64_t state_counter_;
   uint64_t transition_id_;
   uint64_t split_id_;
-  uint64_t particles_stored_;
-  uint64_t particles_simulated_;
+  uint64_t planning_random_seed_;
+  // Target sampling happens serially, but the primary simulator's random
+  // generator is reseeded by propagations, so samples use their own stream.
+  PRNG sampling_rng_;
+  uint64_t merged_expansion_id_;
+  int64_t merged_expansion_parent_index_;
+  std::map<uint64_t, uint64_t> merged_transition_ids_;
+  std::map<uint64_t, uint64_t> merged_split_ids_;
+  std::atomic<uint64_t> particles_stored_;
+  std::atomic<uint64_t> particles_simulated_;
   uint64_t goal_candidates_evaluated_;
+  uint64_t repeated_expansions_skipped_;
   uint64_t goal_reaching_performed_;
   uint64_t goal_reaching_successful_;
   double total_goal_reached_probability_;
   double time_to_first_solution_;
-  double elapsed_clustering_time_;
-  double elapsed_simulation_time_;
+  // Time spent in each phase of planning, reported in the planning
+  // statistics (see AddPhaseTimingStatistics()). Phases may be nested, e.g.
+  // simulation is part of forward propagation. They are mutable so that const
+  // phases (e.g. policy extraction) can be timed too.
+  mutable PhaseTimingStatistics sampling_timing_;
+  mutable PhaseTimingStatistics nearest_neighbors_timing_;
+  mutable PhaseTimingStatistics forward_propagation_timing_;
+  mutable PhaseTimingStatistics simulation_timing_;
+  mutable PhaseTimingStatistics clustering_timing_;
+  mutable PhaseTimingStatistics reverse_edge_check_timing_;
+  mutable PhaseTimingStatistics state_added_timing_;
+  mutable PhaseTimingStatistics goal_check_timing_;
+  mutable PhaseTimingStatistics goal_reached_callback_timing_;
+  mutable PhaseTimingStatistics post_processing_timing_;
+  mutable PhaseTimingStatistics pruning_timing_;
+  mutable PhaseTimingStatistics policy_extraction_timing_;
+  size_t expansion_batch_size_;
   UncertaintyPlanningTreePtr planning_tree_ptr_;
+  // Storage allocated while building the planning tree comes from the session
+  // arena (if ConfigAlloc is SessionArenaAllocator), and is released by
+  // Reset().
+  SessionArena session_arena_;
+  // Session arena allocations made before the last Reset().
+  uint64_t session_arena_allocations_at_reset_;
+  // Children of each planning tree state grouped by transition, updated as
+  // states are added to the planning tree.
+  TransitionChildrenIndex transition_children_index_;
+  NearestNeighborsCache<Configuration, ConfigAlloc> nearest_neighbors_cache_;
+  VantagePointTree nearest_neighbors_index_;
+  bool use_nearest_neighbors_index_;
+  // Lazy reverse edge evaluation, see EnableLazyReverseEdgeEvaluation().
+  // Deferred checks are keyed by provisional reverse transition ID during
+  // forward propagation, then by state index once added to the planning tree.
+  bool lazy_reverse_edge_evaluation_;
+  std::mutex deferred_reverse_edge_checks_mutex_;
+  std::map<uint64_t, DeferredReverseEdgeCheck>
+      propagated_reverse_edge_checks_;
+  std::map<int64_t, DeferredReverseEdgeCheck> deferred_reverse_edge_checks_;
+  bool concurrent_reverse_edge_checks_;
+  // Repeated expansion skipping, see EnableRepeatedExpansionSkipping().
+  static constexpr size_t kMaxExpansionTargetsPerState = 16;
+  bool skip_repeated_expansions_;
+  double repeated_expansion_target_tolerance_;
+  // Whether the last target sampled was a goal sample. Samples are drawn and
+  // their nearest neighbors found serially, one sample at a time.
+  bool last_sample_is_goal_;
   LoggingFunction logging_fn_;
+  // Anytime policy snapshots, see EnablePolicySnapshots(). The worker is
+  // declared last, so that a running extraction finishes before the rest of
+  // the planner is destroyed.
+  PolicySnapshotCallback policy_snapshot_callback_;
+  double policy_snapshot_goal_reached_probability_threshold_;
+  std::chrono::duration<double> policy_snapshot_interval_;
+  double last_snapshot_goal_reached_probability_;
+  std::chrono::time_point<std::chrono::steady_clock> last_snapshot_time_;
+  // Convergence-based termination, see SetConvergenceTermination().
+  double convergence_min_goal_reached_probability_gain_;
+  uint64_t convergence_particle_window_;
+  uint64_t convergence_iteration_window_;
+  uint64_t convergence_iterations_;
+  std::deque<ConvergenceSample> convergence_history_;
+  PlannerTerminationReason termination_reason_;
+  PolicySnapshotWorker policy_snapshot_worker_;
 
   /*
     * Private helper function - needs well-formed inputs, so it isn't safe to
     * expose to external users.
     */
-  inline static void ExtractChildStates(
+  inline static std::vector<int64_t> ExtractChildStates(
       const UncertaintyPlanningTree& raw_planner_tree,
+      const std::vector<uint8_t>& extract_state,
       const int64_t raw_parent_index, const int64_t pruned_parent_index,
       UncertaintyPlanningTree& pruned_planner_tree)
   {
+    if (extract_state.size() != raw_planner_tree.size())
+    {
+      throw std::invalid_argument(
+          "extract_state.size() != raw_planner_tree.size()");
+    }
     if (!raw_planner_tree.at(
             static_cast<size_t>(raw_parent_index)).IsInitialized())
     {
@@ -451,34 +615,53 @@ protected:
     // Clear the child indices, so we can update them with new values later
     pruned_planner_tree.at(
         static_cast<size_t>(pruned_parent_index)).ClearChildIndicies();
-    const std::vector<int64_t>& current_child_indices
-        = raw_planner_tree.at(static_cast<size_t>(raw_parent_index))
-            .GetChildIndices();
-    for (size_t idx = 0; idx < current_child_indices.size(); idx++)
-    {
-      const int64_t raw_child_index = current_child_indices[idx];
-      const UncertaintyPlanningTreeState& current_child_state
-          = raw_planner_tree.at(static_cast<size_t>(raw_child_index));
-      if (current_child_state.GetParentIndex() >= 0)
-      {
-        // Get the new child index
-        const int64_t pruned_child_index
-            = static_cast<int64_t>(pruned_planner_tree.size());
-        // Add to the pruned tree
-        pruned_planner_tree.push_back(current_child_state);
-        // Update parent indices
-        pruned_planner_tree.at(
-            static_cast<size_t>(pruned_child_index)).SetParentIndex(
-                pruned_parent_index);
-        // Update the parent
-        pruned_planner_tree.at(
-            static_cast<size_t>(pruned_parent_index)).AddChildIndex(
-                pruned_child_index);
-        // Recursive call
-        ExtractChildStates(raw_planner_tree, raw_child_index,
-                           pruned_child_index, pruned_planner_tree);
-      }
-    }
+    // Pruned index of each raw state that has been extracted
+    std::vector<int64_t> pruned_indices(raw_planner_tree.size(), -1);
+    pruned_indices.at(static_cast<size_t>(raw_parent_index))
+        = pruned_parent_index;
+    // States are extracted in depth-first order, as if recursively
+    const PlanningTreeChildren raw_tree_children(raw_planner_tree);
+    TraverseDepthFirst(
+        raw_parent_index,
+        [&] (const int64_t raw_state_index)
+        {
+          return raw_tree_children.GetChildIndices(raw_state_index);
+        },
+        [&] (const int64_t raw_state_index) -> bool
+        {
+          // States that are not extracted prune their children too
+          if (extract_state.at(static_cast<size_t>(raw_state_index)) == 0)
+          {
+            return false;
+          }
+          if (raw_state_index == raw_parent_index)
+          {
+            return true;
+          }
+          const UncertaintyPlanningTreeState& current_child_state
+              = raw_planner_tree.at(static_cast<size_t>(raw_state_index));
+          const int64_t pruned_state_parent_index
+              = pruned_indices.at(
+                  static_cast<size_t>(current_child_state.GetParentIndex()));
+          // Get the new child index
+          const int64_t pruned_child_index
+              = static_cast<int64_t>(pruned_planner_tree.size());
+          // Add to the pruned tree
+          pruned_planner_tree.push_back(current_child_state);
+          // Update parent and child indices
+          UncertaintyPlanningTreeState& pruned_child_state
+              = pruned_planner_tree.back();
+          pruned_child_state.SetParentIndex(pruned_state_parent_index);
+          pruned_child_state.ClearChildIndicies();
+          // Update the parent
+          pruned_planner_tree.at(
+              static_cast<size_t>(pruned_state_parent_index)).AddChildIndex(
+                  pruned_child_index);
+          pruned_indices.at(static_cast<size_t>(raw_state_index))
+              = pruned_child_index;
+          return true;
+        });
+    return pruned_indices;
   }
 
   void Log(const std::string& message, const int32_t level) const
@@ -505,9 +688,12 @@ public:
       const SamplerPtr& sampler_ptr,
       const SimulatorPtr& simulator_ptr,
       const ClusteringPtr& clustering_ptr,
-      const LoggingFunction& logging_fn)
+      const LoggingFunction& logging_fn,
+      const ParticleResamplingMethod particle_resampling_method
+          = ParticleResamplingMethod::MULTINOMIAL)
         : robot_ptr_(robot), sampler_ptr_(sampler_ptr),
           simulator_ptr_(simulator_ptr), clustering_ptr_(clustering_ptr),
+          instance_pool_(simulator_ptr, clustering_ptr, sampler_ptr),
           logging_fn_(logging_fn)
   {
     debug_level_ = debug_level;
@@ -518,7 +704,26 @@ public:
     feasibility_alpha_ = feasibility_alpha;
     variance_alpha_ = variance_alpha;
     connect_after_first_solution_ = connect_after_first_solution;
+    particle_resampling_method_ = particle_resampling_method;
+    use_nearest_neighbors_index_ = false;
+    lazy_reverse_edge_evaluation_ = false;
+    concurrent_reverse_edge_checks_ = false;
+    DisableRepeatedExpansionSkipping();
+    expansion_batch_size_ = 1u;
+    DisablePolicySnapshots();
+    SetConvergenceTermination(0.0, 0u, 0u);
+    termination_reason_ = PlannerTerminationReason::NOT_TERMINATED;
     Reset();
+    // If the robot declares a weighted Euclidean metric, nearest-neighbor
+    // distances can be computed in dense batches.
+    const WeightedEuclideanDistanceInterface* euclidean_robot
+        = dynamic_cast<const WeightedEuclideanDistanceInterface*>(
+            robot_ptr_.get());
+    if (euclidean_robot != nullptr)
+    {
+      nearest_neighbors_cache_.EnableWeightedEuclideanDistance(
+          euclidean_robot->GetEuclideanDistanceWeights());
+    }
   }
 
   inline void Reset()
@@ -526,17 +731,29 @@ public:
     state_counter_ = 0;
     transition_id_ = 0;
     split_id_ = 0;
-    elapsed_clustering_time_ = 0.0;
-    elapsed_simulation_time_ = 0.0;
+    planning_random_seed_ = 0;
+    merged_expansion_id_ = 0;
+    merged_expansion_parent_index_ = -1;
+    merged_transition_ids_.clear();
+    merged_split_ids_.clear();
+    propagated_reverse_edge_checks_.clear();
+    deferred_reverse_edge_checks_.clear();
+    ResetPhaseTimingStatistics();
     particles_stored_ = 0;
     particles_simulated_ = 0;
     goal_candidates_evaluated_ = 0;
+    repeated_expansions_skipped_ = 0;
+    last_sample_is_goal_ = false;
     goal_reaching_performed_ = 0;
     goal_reaching_successful_ = 0;
     if (planning_tree_ptr_)
     {
       GetPlanningTreeMutable().clear();
     }
+    ClearNearestNeighbors();
+    transition_children_index_.Clear();
+    session_arena_.Release();
+    session_arena_allocations_at_reset_ = session_arena_.Allocations();
   }
 
   const UncertaintyPlanningTree& GetPlanningTreeImmutable() const
@@ -552,6 +769,167 @@ public:
   void SetPlanningTree(const UncertaintyPlanningTreePtr& tree_ptr)
   {
     planning_tree_ptr_ = tree_ptr;
+    ClearNearestNeighbors();
+    transition_children_index_.Clear();
+    deferred_reverse_edge_checks_.clear();
+  }
+
+  /// The nearest-neighbors index requires that the robot's
+  /// ComputeConfigurationDistance() is a metric, otherwise it may return the
+  /// wrong nearest neighbors, so it is disabled by default, and
+  /// parallel-linear nearest-neighbors are used instead.
+  void EnableNearestNeighborsIndex() { use_nearest_neighbors_index_ = true; }
+
+  void DisableNearestNeighborsIndex() { use_nearest_neighbors_index_ = false; }
+
+  /// With a batch size greater than 1, each planner iteration expands that
+  /// many samples with concurrent forward propagations. Each thread uses its
+  /// own clone of the simulator, clustering, and sampler (see
+  /// PlannerInstancePool), so only the logging and display functions must be
+  /// safe to call from multiple threads at once. If they cannot be cloned,
+  /// batches are propagated on a single thread.
+  void SetExpansionBatchSize(const size_t expansion_batch_size)
+  {
+    if (expansion_batch_size < 1)
+    {
+      throw std::invalid_argument("expansion_batch_size < 1");
+    }
+    expansion_batch_size_ = expansion_batch_size;
+  }
+
+  size_t GetExpansionBatchSize() const { return expansion_batch_size_; }
+
+  /// With lazy reverse edge evaluation, the reverse edge P(feasibility) of a
+  /// new state, which takes a reverse simulation of its particles, is only
+  /// computed when planning needs it (for nominally independent outcomes of a
+  /// split), or when a policy is extracted that may include the state, i.e.
+  /// the state is on a goal branch or is a spur action. The deferred checks
+  /// use the same random streams, so the extracted policy is unchanged.
+  /// States that are never checked keep a reverse edge P(feasibility) of 0 in
+  /// the planning tree.
+  void EnableLazyReverseEdgeEvaluation()
+  {
+    lazy_reverse_edge_evaluation_ = true;
+  }
+
+  void DisableLazyReverseEdgeEvaluation()
+  {
+    lazy_reverse_edge_evaluation_ = false;
+  }
+
+  /// With concurrent reverse edge checks, the reverse edge checks of the
+  /// outcomes of a split are performed concurrently, each thread with its own
+  /// clone of the simulator and clustering (see PlannerInstancePool). As with
+  /// expansion batches, the logging and display functions must be safe to
+  /// call from multiple threads at once. Expansions in a batch already run
+  /// concurrently, so their checks are still performed serially.
+  void EnableConcurrentReverseEdgeChecks()
+  {
+    concurrent_reverse_edge_checks_ = true;
+  }
+
+  void DisableConcurrentReverseEdgeChecks()
+  {
+    concurrent_reverse_edge_checks_ = false;
+  }
+
+  /// With repeated expansion skipping, an expansion from a state towards a
+  /// target within target_tolerance of a target that state has already been
+  /// expanded towards (during the same call to plan) is skipped rather than
+  /// simulated again, and counted as a failed sample. Goal-biased sampling
+  /// keeps drawing the same goal, so without this, every goal sample whose
+  /// nearest state has not changed repeats the same (stochastic) expansion.
+  /// Only goal samples are checked, and only the first few goal targets of
+  /// each state are remembered, since random samples rarely repeat.
+  void EnableRepeatedExpansionSkipping(const double target_tolerance)
+  {
+    if (target_tolerance < 0.0)
+    {
+      throw std::invalid_argument("target_tolerance < 0.0");
+    }
+    skip_repeated_expansions_ = true;
+    repeated_expansion_target_tolerance_ = target_tolerance;
+  }
+
+  void DisableRepeatedExpansionSkipping()
+  {
+    skip_repeated_expansions_ = false;
+    repeated_expansion_target_tolerance_ = 0.0;
+  }
+
+  /// Anytime mode: while planning, whenever P(goal reached) has improved to
+  /// at least goal_reached_probability_threshold, and at least
+  /// snapshot_interval has passed since the last snapshot, a policy is
+  /// extracted from the current planning tree and passed to snapshot_callback
+  /// along with its P(goal reached) (e.g. to store it in a
+  /// PolicySnapshotSlot). Only the pruned tree is copied on the planning
+  /// thread; the policy is extracted on a background thread, which also calls
+  /// snapshot_callback, so the callback and the logging function must be safe
+  /// to call from another thread. Planning does not return until the last
+  /// snapshot has been published.
+  void EnablePolicySnapshots(
+      const PolicySnapshotCallback& snapshot_callback,
+      const double goal_reached_probability_threshold,
+      const std::chrono::duration<double>& snapshot_interval)
+  {
+    if (!snapshot_callback)
+    {
+      throw std::invalid_argument("snapshot_callback is empty");
+    }
+    if (snapshot_interval.count() < 0.0)
+    {
+      throw std::invalid_argument("snapshot_interval < 0");
+    }
+    policy_snapshot_callback_ = snapshot_callback;
+    policy_snapshot_goal_reached_probability_threshold_
+        = goal_reached_probability_threshold;
+    policy_snapshot_interval_ = snapshot_interval;
+  }
+
+  void DisablePolicySnapshots()
+  {
+    policy_snapshot_callback_ = nullptr;
+    policy_snapshot_goal_reached_probability_threshold_ = 0.0;
+    policy_snapshot_interval_ = std::chrono::duration<double>(0.0);
+  }
+
+  /// Convergence-based termination: once a solution has been found, planning
+  /// stops when P(goal reached) has improved by less than
+  /// min_goal_reached_probability_gain over the most recent planner
+  /// iterations that simulated at least particle_window particles and
+  /// numbered at least iteration_window. A gain of 0 disables it. Since
+  /// P(goal reached) only changes when the goal is reached, most consecutive
+  /// iterations show no gain, so a non-zero gain needs a non-zero window.
+  void SetConvergenceTermination(
+      const double min_goal_reached_probability_gain,
+      const uint64_t particle_window, const uint64_t iteration_window)
+  {
+    if (min_goal_reached_probability_gain < 0.0)
+    {
+      throw std::invalid_argument("min_goal_reached_probability_gain < 0");
+    }
+    if (min_goal_reached_probability_gain > 0.0 && particle_window == 0u
+        && iteration_window == 0u)
+    {
+      throw std::invalid_argument(
+          "particle_window or iteration_window must be > 0 if "
+          "min_goal_reached_probability_gain > 0");
+    }
+    convergence_min_goal_reached_probability_gain_
+        = min_goal_reached_probability_gain;
+    convergence_particle_window_ = particle_window;
+    convergence_iteration_window_ = iteration_window;
+  }
+
+  /// Why the most recent planning run stopped.
+  PlannerTerminationReason GetTerminationReason() const
+  {
+    return termination_reason_;
+  }
+
+  ParticleResamplingMethod GetParticleResamplingMethod() const
+  {
+    return particle_resampling_method_;
   }
 
   void InitializePlanningTreeIfNotReady()
@@ -693,20 +1071,43 @@ public:
         = robot_ptr_->ComputeConfigurationDistance(
             state1.GetExpectation(), state2.GetExpectation())
             / step_size_;
-    // Get the Pfeasibility(start -> state1)
+    // Compute the actual distance
+    const double distance
+        = StateDistanceWeight(state1) * expectation_distance;
+    return distance;
+  }
+
+  /*
+    * Weight applied to the expectation distance from state in StateDistance
+    */
+  inline double StateDistanceWeight(
+      const UncertaintyPlanningState& state) const
+  {
+    // Get the Pfeasibility(start -> state)
     const double feasibility_weight
-        = (1.0 - state1.GetMotionPfeasibility())
+        = (1.0 - state.GetMotionPfeasibility())
             * feasibility_alpha_ + (1.0 - feasibility_alpha_);
-    // Get the "space independent" variance of state1
-    const Eigen::VectorXd raw_variances = state1.GetSpaceIndependentVariances();
+    // Get the "space independent" variance of state
+    const Eigen::VectorXd& raw_variances
+        = state.GetSpaceIndependentVariances();
     const double raw_variance = raw_variances.lpNorm<1>();
     // Turn the variance into a weight
     const double variance_weight
         = erf(raw_variance) * variance_alpha_ + (1.0 - variance_alpha_);
-    // Compute the actual distance
-    const double distance
-        = (feasibility_weight * expectation_distance * variance_weight);
-    return distance;
+    return feasibility_weight * variance_weight;
+  }
+
+  /*
+    * Lower bound on StateDistanceWeight for any state, used to prune
+    * nearest-neighbor queries. Pfeasibility is in [0, 1] and erf(variance) is
+    * in [0, 1), so each weight lies between its values at the extremes.
+    */
+  inline double MinimumStateDistanceWeight() const
+  {
+    const double min_feasibility_weight
+        = std::min(1.0, 1.0 - feasibility_alpha_);
+    const double min_variance_weight = std::min(1.0, 1.0 - variance_alpha_);
+    return std::max(0.0, min_feasibility_weight * min_variance_weight);
   }
 
   /*
@@ -748,6 +1149,184 @@ public:
     return best_index;
   }
 
+  /*
+    * Nearest-neighbor cache and index maintenance
+    */
+  inline void ClearNearestNeighbors()
+  {
+    nearest_neighbors_cache_.Clear();
+    nearest_neighbors_index_.Clear();
+  }
+
+  /// Add states added to the tree since the last update to the cache (and
+  /// index), so their weights are computed exactly once.
+  inline void UpdateNearestNeighbors(
+      const UncertaintyPlanningTree& planner_nodes)
+  {
+    if (planner_nodes.size() < nearest_neighbors_cache_.Size())
+    {
+      // The tree has been cleared or replaced since it was cached
+      ClearNearestNeighbors();
+    }
+    for (size_t idx = nearest_neighbors_cache_.Size();
+         idx < planner_nodes.size(); idx++)
+    {
+      const UncertaintyPlanningState& state
+          = planner_nodes.at(idx).GetValueImmutable();
+      if (state.UseForNearestNeighbors())
+      {
+        nearest_neighbors_cache_.AddState(
+            state.GetExpectation(), StateDistanceWeight(state));
+      }
+      else
+      {
+        nearest_neighbors_cache_.AddDisabledState(state.GetExpectation());
+      }
+    }
+    if (use_nearest_neighbors_index_)
+    {
+      const VantagePointTree::ItemDistanceFunction item_distance_fn
+          = [&] (const int64_t first_index, const int64_t second_index)
+      {
+        if (nearest_neighbors_cache_.HasDenseDistances())
+        {
+          return nearest_neighbors_cache_.ComputeDenseDistance(
+              first_index, second_index);
+        }
+        else
+        {
+          return robot_ptr_->ComputeConfigurationDistance(
+              nearest_neighbors_cache_.GetExpectation(first_index),
+              nearest_neighbors_cache_.GetExpectation(second_index));
+        }
+      };
+      for (size_t idx = nearest_neighbors_index_.Size();
+           idx < nearest_neighbors_cache_.Size(); idx++)
+      {
+        nearest_neighbors_index_.Insert(
+            static_cast<int64_t>(idx), item_distance_fn);
+      }
+    }
+  }
+
+  /*
+    * Helper for cached nearest-neighbors, using the index if enabled, and a
+    * parallel-linear scan of the cache otherwise.
+    */
+  inline int64_t GetCachedNearestNeighbor(
+      const UncertaintyPlanningTree& planner_nodes,
+      const UncertaintyPlanningState& random_state)
+  {
+    using common_robotics_utilities::simple_knearest_neighbors
+        ::IndexAndDistance;
+    UpdateNearestNeighbors(planner_nodes);
+    const IndexAndDistance nearest
+        = (use_nearest_neighbors_index_)
+            ? GetIndexedNearestNeighbor(random_state.GetExpectation())
+            : GetLinearNearestNeighbor(random_state.GetExpectation());
+    Log("Selected node " + std::to_string(nearest.Index())
+        + " as nearest neighbor (Qnear) with distance "
+        + std::to_string(nearest.Distance()), 1);
+    return nearest.Index();
+  }
+
+  inline common_robotics_utilities::simple_knearest_neighbors::IndexAndDistance
+  GetIndexedNearestNeighbor(const Configuration& query) const
+  {
+    const VantagePointTree::QueryDistanceFunction query_distance_fn
+        = [&] (const int64_t index)
+    {
+      if (nearest_neighbors_cache_.HasDenseDistances())
+      {
+        return nearest_neighbors_cache_.ComputeDenseDistance(index, query);
+      }
+      else
+      {
+        return robot_ptr_->ComputeConfigurationDistance(
+            nearest_neighbors_cache_.GetExpectation(index), query);
+      }
+    };
+    // Blacklisted states are excluded here rather than removed from the index,
+    // since they remain valid vantage points.
+    const VantagePointTree::CandidateDistanceFunction candidate_distance_fn
+        = [&] (const int64_t index, const double expectation_distance)
+    {
+      return nearest_neighbors_cache_.ScaledDistance(
+          index, expectation_distance / step_size_);
+    };
+    return nearest_neighbors_index_.GetNearestNeighbor(
+        query_distance_fn, candidate_distance_fn,
+        MinimumStateDistanceWeight() / step_size_);
+  }
+
+  inline common_robotics_utilities::simple_knearest_neighbors::IndexAndDistance
+  GetLinearNearestNeighbor(const Configuration& query) const
+  {
+    using common_robotics_utilities::simple_knearest_neighbors
+        ::IndexAndDistance;
+    if (nearest_neighbors_cache_.HasDenseDistances())
+    {
+      // Compute all the distances in a single batch
+      Eigen::VectorXd expectation_distances;
+      nearest_neighbors_cache_.ComputeDenseDistances(
+          query, expectation_distances);
+      IndexAndDistance nearest;
+      for (int64_t idx = 0; idx < expectation_distances.size(); idx++)
+      {
+        const double distance
+            = nearest_neighbors_cache_.ScaledDistance(
+                idx, expectation_distances(idx) / step_size_);
+        if (distance < nearest.Distance())
+        {
+          nearest.SetIndexAndDistance(idx, distance);
+        }
+      }
+      return nearest;
+    }
+    std::vector<IndexAndDistance> per_thread_nearest(
+        common_robotics_utilities::openmp_helpers::GetNumOmpThreads());
+    #pragma omp parallel for
+    for (int64_t idx = 0;
+         idx < static_cast<int64_t>(nearest_neighbors_cache_.Size()); idx++)
+    {
+      if (nearest_neighbors_cache_.IsEnabled(idx))
+      {
+        const double expectation_distance
+            = robot_ptr_->ComputeConfigurationDistance(
+                nearest_neighbors_cache_.GetExpectation(idx), query)
+                / step_size_;
+        const double distance
+            = nearest_neighbors_cache_.ScaledDistance(
+                idx, expectation_distance);
+        const int32_t thread_id
+            = common_robotics_utilities::openmp_helpers
+                ::GetContextOmpThreadNum();
+        // Break ties by index, so the result does not depend on scheduling
+        const IndexAndDistance& thread_nearest
+            = per_thread_nearest.at(thread_id);
+        if ((distance < thread_nearest.Distance())
+            || ((distance == thread_nearest.Distance())
+                && (distance < std::numeric_limits<double>::infinity())
+                && (idx < thread_nearest.Index())))
+        {
+          per_thread_nearest.at(thread_id).SetIndexAndDistance(idx, distance);
+        }
+      }
+    }
+    IndexAndDistance nearest;
+    for (const auto& thread_nearest : per_thread_nearest)
+    {
+      if ((thread_nearest.Distance() < nearest.Distance())
+          || ((thread_nearest.Distance() == nearest.Distance())
+              && (thread_nearest.Index() >= 0)
+              && (thread_nearest.Index() < nearest.Index())))
+      {
+        nearest.SetFromOther(thread_nearest);
+      }
+    }
+    return nearest;
+  }
+
   /*
     * Planning functions
     */
@@ -768,6 +1347,38 @@ public:
       const double policy_marker_size,
       const double p_goal_termination_threshold,
       const DisplayFunction& display_fn)
+  {
+    const UncertaintyPlanningIndexedForwardPropagationFunction
+        indexed_forward_propagation_fn
+            = [&] (const UncertaintyPlanningState& nearest,
+                   const UncertaintyPlanningState& target, const int64_t)
+    {
+      return forward_propagation_fn(nearest, target);
+    };
+    return PlanGoalSampling(
+        start_state, goal_bias, nearest_neighbor_fn,
+        indexed_forward_propagation_fn, user_goal_check_fn, time_limit,
+        edge_attempt_count, policy_action_attempt_count, allow_contacts,
+        include_spur_actions, policy_marker_size, p_goal_termination_threshold,
+        display_fn);
+  }
+
+  inline PlannedPolicyResult PlanGoalSampling(
+      const UncertaintyPlanningState& start_state,
+      const double goal_bias,
+      const UncertaintyPlanningNearestNeighborFunction& nearest_neighbor_fn,
+      const UncertaintyPlanningIndexedForwardPropagationFunction&
+          forward_propagation_fn,
+      const std::function<double(const UncertaintyPlanningState&)>&
+          user_goal_check_fn,
+      const std::chrono::duration<double>& time_limit,
+      const uint32_t edge_attempt_count,
+      const uint32_t policy_action_attempt_count,
+      const bool allow_contacts,
+      const bool include_spur_actions,
+      const double policy_marker_size,
+      const double p_goal_termination_threshold,
+      const DisplayFunction& display_fn)
   {
     // Bind the helper functions
     const auto start_time = std::chrono::steady_clock::now();
@@ -785,62 +1396,76 @@ public:
       return GoalReachedCallback(
           tree, new_goal_state_idx, edge_attempt_count, start_time);
     };
+    const std::function<void(UncertaintyPlanningTree&, const int64_t)>
+        state_added_callback = [&] (
+            UncertaintyPlanningTree& tree, const int64_t new_state_idx)
+    {
+      FinalizeStateIds(tree, new_state_idx);
+      UpdateNearestNeighbors(tree);
+    };
     std::uniform_real_distribution<double> goal_bias_distribution(0.0, 1.0);
     const std::function<UncertaintyPlanningState(void)> complete_sampling_fn
         = [&] (void)
     {
-      if (goal_bias_distribution(simulator_ptr_->GetRandomGenerator())
-          > goal_bias)
+      if (goal_bias_distribution(sampling_rng_) > goal_bias)
       {
         Log("Sampled state", 1);
+        last_sample_is_goal_ = false;
         return SampleRandomTargetState();
       }
       else
       {
         Log("Sampled goal state", 1);
+        last_sample_is_goal_ = true;
         return SampleRandomTargetGoalState();
       }
     };
-    //
+    // Policy snapshots need a virtual goal too, which is sampled from its own
+    // random stream, so that taking snapshots does not change the plan. (Keys
+    // of expansion streams are far smaller than kPolicySnapshotGoalStream.)
+    common_robotics_utilities::OwningMaybe<Configuration> snapshot_virtual_goal;
     const std::function<bool(const int64_t)> termination_check_fn
         = [&] (const int64_t)
     {
-      return PlannerTerminationCheck(
-          start_time, time_limit, p_goal_termination_threshold);
+      if (PlannerTerminationCheck(
+              start_time, time_limit, p_goal_termination_threshold))
+      {
+        return true;
+      }
+      if (PolicySnapshotDue())
+      {
+        if (!snapshot_virtual_goal)
+        {
+          PRNG snapshot_goal_rng(
+              MakeRandomStreamKey(
+                  planning_random_seed_, kPolicySnapshotGoalStream));
+          snapshot_virtual_goal
+              = common_robotics_utilities::OwningMaybe<Configuration>(
+                  SampleValidGoal(snapshot_goal_rng));
+        }
+        PublishPolicySnapshot(
+            snapshot_virtual_goal.Value(), edge_attempt_count,
+            policy_action_attempt_count, include_spur_actions, display_fn);
+      }
+      return false;
     };
     // Call the planner
     // Call the planner
     total_goal_reached_probability_ = 0.0;
     time_to_first_solution_ = 0.0;
-    simulator_ptr_->ResetStatistics();
-    clustering_ptr_->ResetStatistics();
+    instance_pool_.ResetStatistics();
     InitializePlanningTreeIfNotReady();
     GetPlanningTreeMutable().emplace_back(
         UncertaintyPlanningTreeState(start_state));
-    const auto planning_results
-        = common_robotics_utilities::simple_rrt_planner::RRTPlanMultiPath<
-            UncertaintyPlanningState, UncertaintyPlanningState,
-            UncertaintyPlanningStateVector>(
-                GetPlanningTreeMutable(), complete_sampling_fn,
-                nearest_neighbor_fn, forward_propagation_fn, {},
-                goal_reached_fn, goal_reached_callback, termination_check_fn);
+    const auto planning_results = PlanMultiplePaths(
+        complete_sampling_fn, nearest_neighbor_fn, forward_propagation_fn,
+        state_added_callback, goal_reached_fn, goal_reached_callback,
+        termination_check_fn);
     // It "shouldn't" matter what the goal state actually is, since it's more of
     // a virtual node to tie the policy graph together, but it probably needs to
     // be collision-free.
-    auto valid_goal_sampling_fn = [&] ()
-    {
-      while (true)
-      {
-        const Configuration goal_sample
-            = sampler_ptr_->SampleGoal(simulator_ptr_->GetRandomGenerator());
-        if (simulator_ptr_->CheckConfigCollision(robot_ptr_, goal_sample)
-            == false)
-        {
-          return goal_sample;
-        }
-      }
-    };
-    const Configuration virtual_goal = valid_goal_sampling_fn();
+    const Configuration virtual_goal
+        = SampleValidGoal(simulator_ptr_->GetRandomGenerator());
     return ProcessPlanningResults(
         planning_results, virtual_goal, edge_attempt_count,
         policy_action_attempt_count, include_spur_actions, policy_marker_size,
@@ -863,13 +1488,15 @@ public:
       const double p_goal_termination_threshold,
       const DisplayFunction& display_fn)
   {
-    const UncertaintyPlanningForwardPropagationFunction forward_propagation_fn =
-        [&] (const UncertaintyPlanningState& nearest,
-             const UncertaintyPlanningState& target)
+    const UncertaintyPlanningIndexedForwardPropagationFunction
+        forward_propagation_fn
+            = [&] (const UncertaintyPlanningState& nearest,
+                   const UncertaintyPlanningState& target,
+                   const int64_t expansion_index)
     {
       return PropagateForwardsAndDraw(
           nearest, target, edge_attempt_count, allow_contacts,
-          include_reverse_actions, display_fn);
+          include_reverse_actions, expansion_index, display_fn);
     };
     return PlanGoalSampling(
         start_state, goal_bias, nearest_neighbor_fn, forward_propagation_fn,
@@ -919,18 +1546,11 @@ public:
       std::cout << "Press ENTER to start planning..." << std::endl;
       std::cin.get();
     }
-    const StateDistanceFunction state_distance_fn
-        = [&] (const UncertaintyPlanningState& state1,
-               const UncertaintyPlanningState& state2)
-    {
-      return StateDistance(state1, state2);
-    };
     const UncertaintyPlanningNearestNeighborFunction nearest_neighbor_fn
         = [&] (const UncertaintyPlanningTree& tree,
                const UncertaintyPlanningState& new_state)
     {
-      return GetNearestNeighbor(
-          tree, new_state, state_distance_fn, logging_fn_);
+      return GetCachedNearestNeighbor(tree, new_state);
     };
     UncertaintyPlanningState start_state(start);
     return PlanGoalSampling(
@@ -992,18 +1612,11 @@ public:
     UncertaintyPlanningState goal_state(goal);
     // Bind the helper functions
     const auto start_time = std::chrono::steady_clock::now();
-    const StateDistanceFunction state_distance_fn
-        = [&] (const UncertaintyPlanningState& state1,
-               const UncertaintyPlanningState& state2)
-    {
-      return StateDistance(state1, state2);
-    };
     const UncertaintyPlanningNearestNeighborFunction nearest_neighbor_fn
         = [&] (const UncertaintyPlanningTree& tree,
                const UncertaintyPlanningState& new_state)
     {
-      return GetNearestNeighbor(
-          tree, new_state, state_distance_fn, logging_fn_);
+      return GetCachedNearestNeighbor(tree, new_state);
     };
     const std::function<bool(const UncertaintyPlanningState&)> goal_reached_fn
         = [&] (const UncertaintyPlanningState& goal_candidate)
@@ -1018,52 +1631,68 @@ public:
       return GoalReachedCallback(
           tree, new_goal_state_idx, edge_attempt_count, start_time);
     };
+    const std::function<void(UncertaintyPlanningTree&, const int64_t)>
+        state_added_callback = [&] (
+            UncertaintyPlanningTree& tree, const int64_t new_state_idx)
+    {
+      FinalizeStateIds(tree, new_state_idx);
+      UpdateNearestNeighbors(tree);
+    };
     std::uniform_real_distribution<double> goal_bias_distribution(0.0, 1.0);
     const std::function<UncertaintyPlanningState(void)> complete_sampling_fn
         = [&](void)
     {
-      if (goal_bias_distribution(simulator_ptr_->GetRandomGenerator())
-          > goal_bias)
+      if (goal_bias_distribution(sampling_rng_) > goal_bias)
       {
         Log("Sampled state", 1);
+        last_sample_is_goal_ = false;
         return SampleRandomTargetState();
       }
       else
       {
         Log("Sampled goal state", 1);
+        last_sample_is_goal_ = true;
         return goal_state;
       }
     };
-    const UncertaintyPlanningForwardPropagationFunction forward_propagation_fn
-        = [&] (const UncertaintyPlanningState& nearest,
-               const UncertaintyPlanningState& target)
+    const UncertaintyPlanningIndexedForwardPropagationFunction
+        forward_propagation_fn
+            = [&] (const UncertaintyPlanningState& nearest,
+                   const UncertaintyPlanningState& target,
+                   const int64_t expansion_index)
     {
       return PropagateForwardsAndDraw(
           nearest, target, edge_attempt_count, allow_contacts,
-          include_reverse_actions, display_fn);
+          include_reverse_actions, expansion_index, display_fn);
     };
     const std::function<bool(const int64_t)> termination_check_fn
         = [&] (const int64_t)
     {
-      return PlannerTerminationCheck(
-          start_time, time_limit, p_goal_termination_threshold);
+      if (PlannerTerminationCheck(
+              start_time, time_limit, p_goal_termination_threshold))
+      {
+        return true;
+      }
+      if (PolicySnapshotDue())
+      {
+        PublishPolicySnapshot(
+            goal, edge_attempt_count, policy_action_attempt_count,
+            include_spur_actions, display_fn);
+      }
+      return false;
     };
     // Call the planner
     // Call the planner
     total_goal_reached_probability_ = 0.0;
     time_to_first_solution_ = 0.0;
-    simulator_ptr_->ResetStatistics();
-    clustering_ptr_->ResetStatistics();
+    instance_pool_.ResetStatistics();
     InitializePlanningTreeIfNotReady();
     GetPlanningTreeMutable().emplace_back(
         UncertaintyPlanningTreeState(start_state));
-    auto planning_results
-      = common_robotics_utilities::simple_rrt_planner::RRTPlanMultiPath<
-          UncertaintyPlanningState, UncertaintyPlanningState,
-          UncertaintyPlanningStateVector>(
-              GetPlanningTreeMutable(), complete_sampling_fn,
-              nearest_neighbor_fn, forward_propagation_fn, {}, goal_reached_fn,
-              goal_reached_callback, termination_check_fn);
+    const auto planning_results = PlanMultiplePaths(
+        complete_sampling_fn, nearest_neighbor_fn, forward_propagation_fn,
+        state_added_callback, goal_reached_fn, goal_reached_callback,
+        termination_check_fn);
     return ProcessPlanningResults(
         planning_results, goal, edge_attempt_count, policy_action_attempt_count,
         include_spur_actions, policy_marker_size, display_fn);
@@ -1075,6 +1704,250 @@ protected:
           ::MultipleSolutionPlanningResults<
               UncertaintyPlanningState, UncertaintyPlanningStateVector>;
 
+  /*
+    * Run the RRT planner over the planning tree, expanding either one sample
+    * at a time or in concurrent batches of expansion_batch_size_ samples.
+    * Random numbers used by each expansion come from streams keyed by the
+    * planning seed and the expansion's IDs, so the resulting tree does not
+    * depend on the number of threads or on scheduling.
+    */
+  inline PlanMultiplePathsResult PlanMultiplePaths(
+      const std::function<UncertaintyPlanningState(void)>& sampling_fn,
+      const UncertaintyPlanningNearestNeighborFunction& nearest_neighbor_fn,
+      const UncertaintyPlanningIndexedForwardPropagationFunction&
+          forward_propagation_fn,
+      const std::function<void(UncertaintyPlanningTree&, const int64_t)>&
+          state_added_callback,
+      const std::function<bool(const UncertaintyPlanningState&)>&
+          goal_reached_fn,
+      const std::function<void(UncertaintyPlanningTree&, const int64_t)>&
+          goal_reached_callback,
+      const std::function<bool(const int64_t)>& termination_check_fn)
+  {
+    planning_random_seed_ = simulator_ptr_->GetRandomGenerator()();
+    sampling_rng_.seed(MakeRandomStreamKey(planning_random_seed_, 0u));
+    merged_expansion_id_ = 0;
+    merged_expansion_parent_index_ = -1;
+    merged_transition_ids_.clear();
+    merged_split_ids_.clear();
+    propagated_reverse_edge_checks_.clear();
+    convergence_iterations_ = 0;
+    convergence_history_.clear();
+    termination_reason_ = PlannerTerminationReason::NOT_TERMINATED;
+    last_snapshot_goal_reached_probability_ = 0.0;
+    last_snapshot_time_
+        = std::chrono::steady_clock::now()
+          - std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+              policy_snapshot_interval_);
+    size_t num_instances = 1;
+    if ((expansion_batch_size_ > 1) || concurrent_reverse_edge_checks_)
+    {
+      // Each thread propagates (or checks reverse edges) with its own
+      // simulator, clustering, and sampler
+      num_instances = instance_pool_.ResizeForOmpThreads(planning_random_seed_);
+      if (num_instances == 1)
+      {
+        Log("Simulator, clustering, or sampler cannot be cloned, batched "
+            "expansions and reverse edge checks will run on a single thread",
+            2);
+      }
+    }
+    else
+    {
+      instance_pool_.Resize(1, planning_random_seed_);
+    }
+    // Single expansions are propagated on the calling thread, so that their
+    // reverse edge checks can use the other threads.
+    size_t num_propagation_threads = 1;
+    if (expansion_batch_size_ > 1)
+    {
+      num_propagation_threads = num_instances;
+      Log("Planning with expansion batches of "
+          + std::to_string(expansion_batch_size_) + " samples on "
+          + std::to_string(num_propagation_threads) + " threads", 1);
+    }
+    // Tree states are allocated from the session arena, both by the
+    // propagations (on whichever threads run them) and when they are merged.
+    const SessionArenaScope arena_scope(session_arena_);
+    // Goal targets each state has been expanded towards, and whether each
+    // sample repeats an earlier expansion (see
+    // EnableRepeatedExpansionSkipping()). Both are updated serially as nearest
+    // neighbors are found, which is also the order in which samples are
+    // numbered, so whether an expansion is skipped does not depend on
+    // batching.
+    std::map<int64_t, ConfigVector> expanded_targets;
+    std::vector<uint8_t> repeated_expansions;
+    const UncertaintyPlanningIndexedForwardPropagationFunction
+        arena_forward_propagation_fn = [&] (
+            const UncertaintyPlanningState& nearest,
+            const UncertaintyPlanningState& target, const int64_t sample_index)
+        -> UncertaintyPlanningStateForwardPropagation
+    {
+      if (skip_repeated_expansions_
+          && repeated_expansions.at(static_cast<size_t>(sample_index)) > 0)
+      {
+        return UncertaintyPlanningStateForwardPropagation();
+      }
+      const SessionArenaScope propagation_arena_scope(session_arena_);
+      const ScopedPhaseTimer timer(forward_propagation_timing_);
+      return forward_propagation_fn(nearest, target, sample_index);
+    };
+    // Time each phase of planning
+    const std::function<UncertaintyPlanningState(void)> timed_sampling_fn
+        = [&] (void)
+    {
+      const ScopedPhaseTimer timer(sampling_timing_);
+      return sampling_fn();
+    };
+    const UncertaintyPlanningNearestNeighborFunction
+        timed_nearest_neighbor_fn
+            = [&] (const UncertaintyPlanningTree& tree,
+                   const UncertaintyPlanningState& new_state)
+    {
+      int64_t nearest_index = -1;
+      {
+        const ScopedPhaseTimer timer(nearest_neighbors_timing_);
+        nearest_index = nearest_neighbor_fn(tree, new_state);
+      }
+      if (skip_repeated_expansions_ && nearest_index >= 0)
+      {
+        const bool repeated = last_sample_is_goal_ && RecordExpansionTarget(
+            new_state.GetExpectation(), expanded_targets[nearest_index]);
+        repeated_expansions.push_back(static_cast<uint8_t>(repeated));
+        if (repeated)
+        {
+          repeated_expansions_skipped_++;
+        }
+      }
+      return nearest_index;
+    };
+    const std::function<void(UncertaintyPlanningTree&, const int64_t)>
+        timed_state_added_callback = [&] (
+            UncertaintyPlanningTree& tree, const int64_t new_state_idx)
+    {
+      const ScopedPhaseTimer timer(state_added_timing_);
+      state_added_callback(tree, new_state_idx);
+    };
+    const std::function<bool(const UncertaintyPlanningState&)>
+        timed_goal_reached_fn
+            = [&] (const UncertaintyPlanningState& goal_candidate)
+    {
+      const ScopedPhaseTimer timer(goal_check_timing_);
+      return goal_reached_fn(goal_candidate);
+    };
+    const std::function<void(UncertaintyPlanningTree&, const int64_t)>
+        timed_goal_reached_callback = [&] (
+            UncertaintyPlanningTree& tree, const int64_t new_goal_state_idx)
+    {
+      const ScopedPhaseTimer timer(goal_reached_callback_timing_);
+      goal_reached_callback(tree, new_goal_state_idx);
+    };
+    const PlanMultiplePathsResult planning_results
+        = BatchedRRTPlanMultiPath<
+            UncertaintyPlanningState, UncertaintyPlanningState,
+            UncertaintyPlanningStateVector>(
+                GetPlanningTreeMutable(), timed_sampling_fn,
+                timed_nearest_neighbor_fn, arena_forward_propagation_fn,
+                timed_state_added_callback, timed_goal_reached_fn,
+                timed_goal_reached_callback, termination_check_fn,
+                expansion_batch_size_,
+                static_cast<int32_t>(num_propagation_threads));
+    // Make sure the last snapshot has been published before returning
+    policy_snapshot_worker_.Wait();
+    // The planner only stops without the termination check if it ran out of
+    // states to expand
+    if (termination_reason_ == PlannerTerminationReason::NOT_TERMINATED)
+    {
+      Log("Terminated, no expandable states left", 0);
+      termination_reason_ = PlannerTerminationReason::NO_EXPANDABLE_STATES;
+    }
+    // Which streams the primary simulator was last reseeded with depends on
+    // scheduling, so reseed it deterministically for whatever comes next.
+    simulator_ptr_->GetRandomGenerator().seed(sampling_rng_());
+    return planning_results;
+  }
+
+  /*
+    * Record that a state is expanded towards target, returning true if it has
+    * already been expanded towards a target within the tolerance. At most
+    * kMaxExpansionTargetsPerState targets are recorded for each state.
+    */
+  inline bool RecordExpansionTarget(
+      const Configuration& target, ConfigVector& expanded_targets) const
+  {
+    for (const Configuration& expanded_target : expanded_targets)
+    {
+      if (robot_ptr_->ComputeConfigurationDistance(expanded_target, target)
+          <= repeated_expansion_target_tolerance_)
+      {
+        return true;
+      }
+    }
+    if (expanded_targets.size() < kMaxExpansionTargetsPerState)
+    {
+      expanded_targets.push_back(target);
+    }
+    return false;
+  }
+
+  /*
+    * Replace the provisional IDs assigned to a newly-added state during
+    * forward propagation with sequential IDs. States are added to the tree
+    * serially and in sample order, so the final IDs are deterministic.
+    * States propagated by user-provided functions (which do not use
+    * provisional IDs) are left unchanged.
+    */
+  inline void FinalizeStateIds(
+      UncertaintyPlanningTree& tree, const int64_t new_state_idx)
+  {
+    UncertaintyPlanningState& new_state
+        = tree.at(static_cast<size_t>(new_state_idx)).GetValueMutable();
+    const uint64_t expansion_id
+        = ExpansionContext::GetExpansionId(new_state.GetTransitionId());
+    if (expansion_id == 0)
+    {
+      return;
+    }
+    // Provisional IDs are unique within an expansion, so only the mappings
+    // for the current expansion need to be kept.
+    if (expansion_id != merged_expansion_id_)
+    {
+      merged_expansion_id_ = expansion_id;
+      // Every state of an expansion is propagated from the parent of its
+      // first state (see PerformForwardPropagation())
+      merged_expansion_parent_index_
+          = tree.at(static_cast<size_t>(new_state_idx)).GetParentIndex();
+      merged_transition_ids_.clear();
+      merged_split_ids_.clear();
+    }
+    DeferMergedReverseEdgeCheck(new_state_idx, new_state);
+    const auto get_final_id = [] (
+        const uint64_t provisional_id, uint64_t& id_counter,
+        std::map<uint64_t, uint64_t>& final_ids)
+    {
+      const auto found_itr = final_ids.find(provisional_id);
+      if (found_itr != final_ids.end())
+      {
+        return found_itr->second;
+      }
+      const uint64_t final_id = ++id_counter;
+      final_ids[provisional_id] = final_id;
+      return final_id;
+    };
+    const uint64_t state_id = ++state_counter_;
+    const uint64_t transition_id = get_final_id(
+        new_state.GetTransitionId(), transition_id_, merged_transition_ids_);
+    const uint64_t reverse_transition_id = get_final_id(
+        new_state.GetReverseTransitionId(), transition_id_,
+        merged_transition_ids_);
+    const uint64_t split_id
+        = (new_state.GetSplitId() > 0)
+          ? get_final_id(new_state.GetSplitId(), split_id_, merged_split_ids_)
+          : 0u;
+    new_state.SetStateAndTransitionIds(
+        state_id, transition_id, reverse_transition_id, split_id);
+  }
+
   inline PlannedPolicyResult ProcessPlanningResults(
       const PlanMultiplePathsResult& planning_results,
       const Configuration& virtual_goal_config,
@@ -1092,39 +1965,72 @@ protected:
     planning_statistics["P(goal reached)"] = total_goal_reached_probability_;
     planning_statistics["Time to first solution"] = time_to_first_solution_;
     const std::map<std::string, double> simulator_resolve_statistics
-        = simulator_ptr_->GetStatistics();
+        = instance_pool_.GetSimulatorStatistics();
     planning_statistics.insert(
         simulator_resolve_statistics.begin(),
         simulator_resolve_statistics.end());
     const std::map<std::string, double> outcome_clustering_statistics
-        = clustering_ptr_->GetStatistics();
+        = instance_pool_.GetClusteringStatistics();
     planning_statistics.insert(
         outcome_clustering_statistics.begin(),
         outcome_clustering_statistics.end());
-    planning_statistics["elapsed_clustering_time"] = elapsed_clustering_time_;
-    planning_statistics["elapsed_simulation_time"] = elapsed_simulation_time_;
+    planning_statistics["elapsed_clustering_time"]
+        = clustering_timing_.TotalSeconds();
+    planning_statistics["elapsed_simulation_time"]
+        = simulation_timing_.TotalSeconds();
     planning_statistics["Particles stored"]
         = static_cast<double>(particles_stored_);
     planning_statistics["Particles simulated"]
         = static_cast<double>(particles_simulated_);
     planning_statistics["Goal candidates evaluated"]
         = static_cast<double>(goal_candidates_evaluated_);
+    planning_statistics["Repeated expansions skipped"]
+        = static_cast<double>(repeated_expansions_skipped_);
+    planning_statistics["repeated_expansions_skipped"]
+        = static_cast<double>(repeated_expansions_skipped_);
+    // Only counts storage allocated through ConfigAlloc (e.g. particle
+    // vectors), not storage allocated by the configurations themselves.
+    const double arena_allocations = static_cast<double>(
+        session_arena_.Allocations() - session_arena_allocations_at_reset_);
+    const double total_samples = planning_statistics["total_samples"];
+    planning_statistics["Arena allocations"] = arena_allocations;
+    planning_statistics["Arena allocations per expansion"]
+        = (total_samples > 0.0) ? (arena_allocations / total_samples) : 0.0;
     planning_statistics["Goal reaching performed"]
         = static_cast<double>(goal_reaching_performed_);
     planning_statistics["Goal reaching successful"]
         = static_cast<double>(goal_reaching_successful_);
+    // See PlannerTerminationReason for the values
+    planning_statistics["Termination reason"]
+        = static_cast<double>(termination_reason_);
     if (total_goal_reached_probability_ >= goal_probability_threshold_)
     {
-      const UncertaintyPlanningTree postprocessed_tree
-          = PostProcessTree(GetPlanningTreeImmutable());
-      const UncertaintyPlanningTree pruned_tree
-          = PruneTree(postprocessed_tree, include_spur_actions);
-      const UncertaintyPlanningPolicy policy = ExtractPolicy(
-          pruned_tree, virtual_goal_config, edge_attempt_count,
+      // Deferred reverse edge checks reseed the simulator, which is left as
+      // planning left it.
+      const PRNG simulator_rng = simulator_ptr_->GetRandomGenerator();
+      PerformPolicyReverseEdgeChecks(include_spur_actions, display_fn);
+      simulator_ptr_->GetRandomGenerator() = simulator_rng;
+    }
+    planning_statistics["Reverse edge checks skipped"]
+        = static_cast<double>(deferred_reverse_edge_checks_.size());
+    if (total_goal_reached_probability_ >= goal_probability_threshold_)
+    {
+      transition_children_index_.Update(GetPlanningTreeImmutable());
+      // Post-processing and pruning only annotate the planning tree, so the
+      // surviving states are copied once, into the policy's tree.
+      const std::vector<double> postprocessed_goal_probabilities
+          = PostProcessTree(
+              GetPlanningTreeImmutable(), transition_children_index_);
+      UncertaintyPlanningPolicy policy = ExtractPolicy(
+          PruneTree(
+              GetPlanningTreeImmutable(), postprocessed_goal_probabilities,
+              include_spur_actions),
+          virtual_goal_config, edge_attempt_count,
           policy_action_attempt_count);
       planning_statistics["Extracted policy size"]
           = static_cast<double>(
               policy.GetRawPolicy().GetNodesImmutable().size());
+      AddPhaseTimingStatistics(planning_statistics);
       if (debug_level_ >= 2)
       {
         std::cout << "Press ENTER to draw planned paths..." << std::endl;
@@ -1201,11 +2107,12 @@ protected:
                         planning_statistics)
                     << std::endl;
       }
-      return PlannedPolicyResult(policy, planning_statistics);
+      return PlannedPolicyResult(std::move(policy), planning_statistics);
     }
     else
     {
       planning_statistics["Extracted policy size"] = 0.0;
+      AddPhaseTimingStatistics(planning_statistics);
       // Wait for input
       if (debug_level_ >= 2)
       {
@@ -1224,84 +2131,112 @@ protected:
   /*
     * Solution tree post-processing functions
     */
-  inline UncertaintyPlanningTree PostProcessTree(
-      const UncertaintyPlanningTree& planner_tree) const
+  /// Returns the post-processed P(goal reached) of every state in the tree,
+  /// rather than a post-processed copy of the tree.
+  inline std::vector<double> PostProcessTree(
+      const UncertaintyPlanningTree& planner_tree,
+      const TransitionChildrenIndex& transition_children_index) const
   {
+    const ScopedPhaseTimer timer(post_processing_timing_);
     Log("Postprocessing planner tree for policy extraction...", 1);
     const auto start_time = std::chrono::steady_clock::now();
     // Let's do some post-processing to the planner tree - we don't want to mess
-    // with the original tree, so we copy it
-    UncertaintyPlanningTree postprocessed_planner_tree = planner_tree;
+    // with the original tree, so we only update P(goal reached) of each state
+    std::vector<double> goal_probabilities(planner_tree.size(), 0.0);
+    for (size_t sdx = 0; sdx < planner_tree.size(); sdx++)
+    {
+      goal_probabilities.at(sdx)
+          = planner_tree.at(sdx).GetValueImmutable().GetGoalPfeasibility();
+    }
     // We have already computed reversibility for all edges, however, we now
-    // need to update the P(goal reached) for reversible children. We start with
-    // a naive implementation of this - this works because given the process
-    // that the tree is generated, children *MUST* have higher indices than
-    // their parents, so we can depend on the parents having been updated first
-    // by the time we get to an index. To make this parallelizable, we'll need
-    // to switch to an explicitly branch-based approach.
+    // need to update the P(goal reached) for reversible children. Only states
+    // that are not on a goal branch are updated, and the update of a state only
+    // depends on the P(goal reached) of its parent and siblings that *are* on a
+    // goal branch, which never changes here. So every state can be updated
+    // independently, using the values in the original tree, and the tree does
+    // not need to be processed in order (i.e. parents before children).
     // Go through each state in the tree - we skip the initial state, since it
     // has no transition.
-    for (size_t sdx = 1; sdx < postprocessed_planner_tree.size(); sdx++)
+    std::vector<std::exception_ptr> postprocessing_errors(planner_tree.size());
+    #pragma omp parallel for schedule(static)
+    for (int64_t sdx = 1; sdx < static_cast<int64_t>(planner_tree.size());
+         sdx++)
     {
-      // Get the current state
-      UncertaintyPlanningTreeState& current_state
-          = postprocessed_planner_tree.at(sdx);
-      const int64_t parent_index = current_state.GetParentIndex();
-      // Get the parent state
-      const UncertaintyPlanningTreeState& parent_state
-          = postprocessed_planner_tree.at(static_cast<size_t>(parent_index));
-      // If the current state is on a goal branch
-      if (current_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
-      {
-        // Reversibility has already been computed
-        continue;
-      }
-      // If we are a non-goal child of a goal branch state
-      else if (parent_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
-      {
-        // Make sure we're a child of a split where at least one child reaches
-        // the goal
-        const uint64_t transition_id
-            = current_state.GetValueImmutable().GetTransitionId();
-        const uint64_t state_id
-            = current_state.GetValueImmutable().GetStateId();
-        bool result_of_goal_reaching_split = false;
-        for (const int64_t other_child_index : parent_state.GetChildIndices())
+      try
+      {
+        // Get the current state
+        const UncertaintyPlanningTreeState& current_state
+            = planner_tree.at(static_cast<size_t>(sdx));
+        const int64_t parent_index = current_state.GetParentIndex();
+        // Get the parent state
+        const UncertaintyPlanningTreeState& parent_state
+            = planner_tree.at(static_cast<size_t>(parent_index));
+        // If the current state is on a goal branch
+        if (current_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
+        {
+          // Reversibility has already been computed
+          continue;
+        }
+        // If we are a non-goal child of a goal branch state
+        else if (parent_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
         {
-          const UncertaintyPlanningTreeState& other_child_state
-              = postprocessed_planner_tree.at(
-                  static_cast<size_t>(other_child_index));
-          const uint64_t other_child_transition_id
-              = other_child_state.GetValueImmutable().GetTransitionId();
-          const uint64_t other_child_state_id
-              = other_child_state.GetValueImmutable().GetStateId();
-          // If it's a child of the same split that produced us
-          if ((state_id != other_child_state_id)
-              && (transition_id == other_child_transition_id))
+          // Make sure we're a child of a split where at least one child
+          // reaches the goal
+          const uint64_t transition_id
+              = current_state.GetValueImmutable().GetTransitionId();
+          const uint64_t state_id
+              = current_state.GetValueImmutable().GetStateId();
+          bool result_of_goal_reaching_split = false;
+          for (const int64_t other_child_index
+                  : transition_children_index.GetTransitionChildIndices(
+                      parent_index, transition_id))
           {
-            const double other_child_goal_probability
-                = other_child_state.GetValueImmutable().GetGoalPfeasibility();
-            if (other_child_goal_probability > 0.0)
+            const UncertaintyPlanningTreeState& other_child_state
+                = planner_tree.at(static_cast<size_t>(other_child_index));
+            const uint64_t other_child_state_id
+                = other_child_state.GetValueImmutable().GetStateId();
+            // If it's another child of the same split that produced us
+            if (state_id != other_child_state_id)
             {
-              result_of_goal_reaching_split = true;
-              break;
+              const double other_child_goal_probability
+                  = other_child_state.GetValueImmutable()
+                      .GetGoalPfeasibility();
+              if (other_child_goal_probability > 0.0)
+              {
+                result_of_goal_reaching_split = true;
+                break;
+              }
             }
           }
+          if (result_of_goal_reaching_split)
+          {
+            // Update P(goal reached) based on our ability to reverse to the
+            // goal branch
+            const double parent_pgoalreached
+                = parent_state.GetValueImmutable().GetGoalPfeasibility();
+            // We use negative goal reached probabilities to signal
+            // probability due to reversing
+            const double new_pgoalreached
+                = -(parent_pgoalreached
+                    * current_state.GetValueImmutable()
+                        .GetReverseEdgePfeasibility());
+            goal_probabilities.at(static_cast<size_t>(sdx)) = new_pgoalreached;
+          }
         }
-        if (result_of_goal_reaching_split)
-        {
-          // Update P(goal reached) based on our ability to reverse to the goal
-          // branch
-          const double parent_pgoalreached
-              = parent_state.GetValueImmutable().GetGoalPfeasibility();
-          // We use negative goal reached probabilities to signal probability
-          // due to reversing
-          const double new_pgoalreached
-              = -(parent_pgoalreached
-                  * current_state.GetValueImmutable()
-                      .GetReverseEdgePfeasibility());
-          current_state.GetValueMutable().SetGoalPfeasibility(new_pgoalreached);
-        }
+      }
+      catch (...)
+      {
+        // Exceptions cannot leave an OpenMP parallel region
+        postprocessing_errors.at(static_cast<size_t>(sdx))
+            = std::current_exception();
+      }
+    }
+    for (const std::exception_ptr& postprocessing_error
+            : postprocessing_errors)
+    {
+      if (postprocessing_error)
+      {
+        std::rethrow_exception(postprocessing_error);
       }
     }
     const auto end_time = std::chrono::steady_clock::now();
@@ -1309,13 +2244,22 @@ protected:
         end_time - start_time);
     Log("...postprocessing complete, took "
         + std::to_string(postprocessing_time.count()) + " seconds", 1);
-    return postprocessed_planner_tree;
+    return goal_probabilities;
   }
 
+  /// Returns a copy of only the states of planner_tree that are kept for
+  /// policy extraction, with P(goal reached) set from the post-processed
+  /// goal_probabilities.
   inline UncertaintyPlanningTree PruneTree(
       const UncertaintyPlanningTree& planner_tree,
+      const std::vector<double>& goal_probabilities,
       const bool include_spur_actions) const
   {
+    if (goal_probabilities.size() != planner_tree.size())
+    {
+      throw std::invalid_argument(
+          "goal_probabilities.size() != planner_tree.size()");
+    }
     if (planner_tree.size() <= 1)
     {
       return planner_tree;
@@ -1327,57 +2271,55 @@ protected:
       throw std::runtime_error("planner_tree has invalid linkage");
     }
     Log("Pruning planner tree in preparation for policy extraction...", 1);
+    const ScopedPhaseTimer timer(pruning_timing_);
     const auto start_time = std::chrono::steady_clock::now();
     // Let's do some post-processing to the planner tree - we don't want to mess
-    // with the original tree, so we copy it
-    UncertaintyPlanningTree intermediate_planner_tree = planner_tree;
-    // Loop through the tree and prune unproductive nodes+edges
-    for (size_t idx = 0; idx < intermediate_planner_tree.size(); idx++)
+    // with the original tree, so we mark the nodes+edges to keep instead
+    std::vector<uint8_t> keep_state(planner_tree.size(), 0);
+    size_t num_kept_states = 0;
+    for (size_t idx = 0; idx < planner_tree.size(); idx++)
     {
-      UncertaintyPlanningTreeState& current_state
-          = intermediate_planner_tree.at(idx);
-      if (current_state.IsInitialized() == false)
+      if (planner_tree.at(idx).IsInitialized() == false)
       {
         throw std::runtime_error("current_state is uninitialized");
       }
+      const double goal_probability = goal_probabilities.at(idx);
       // If we're on a path to the goal, we always keep it
-      if (current_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
-      {
-        continue;
-      }
-      // If the current node can reverse to reach the goal
-      else if (current_state.GetValueImmutable().GetGoalPfeasibility() < -0.0)
-      {
-        // If we allow spur nodes, we keep it
-        if (include_spur_actions)
-        {
-          continue;
-        }
-        // If not, prune the node
-        else
-        {
-          current_state.SetParentIndex(-1);
-          current_state.ClearChildIndicies();
-        }
-      }
+      // If the current node can reverse to reach the goal, we keep it if we
+      // allow spur nodes
       // We always prune nodes that can't reach the goal
-      else
+      if ((goal_probability > 0.0)
+          || (goal_probability < -0.0 && include_spur_actions))
       {
-        current_state.SetParentIndex(-1);
-        current_state.ClearChildIndicies();
+        keep_state.at(idx) = 1;
+        num_kept_states++;
       }
     }
     // Now, extract the pruned tree
     UncertaintyPlanningTree pruned_planner_tree;
-    // Add root state
-    const auto& root_state = intermediate_planner_tree.at(0);
+    // Tree states are copied, not moved, when the tree grows
+    pruned_planner_tree.reserve(num_kept_states + 1);
+    // Add root state, which is always kept (but its children may not be)
+    const auto& root_state = planner_tree.at(0);
     if (root_state.IsInitialized() == false)
     {
       throw std::runtime_error("root_state is uninitialized");
     }
     pruned_planner_tree.push_back(root_state);
-    // Recursive call to extract live branches
-    ExtractChildStates(intermediate_planner_tree, 0, 0, pruned_planner_tree);
+    // Extract live branches
+    const std::vector<int64_t> pruned_indices
+        = ExtractChildStates(planner_tree, keep_state, 0, 0,
+                             pruned_planner_tree);
+    // Apply the post-processed P(goal reached)
+    for (size_t idx = 0; idx < pruned_indices.size(); idx++)
+    {
+      const int64_t pruned_index = pruned_indices.at(idx);
+      if (pruned_index >= 0)
+      {
+        pruned_planner_tree.at(static_cast<size_t>(pruned_index))
+            .GetValueMutable().SetGoalPfeasibility(goal_probabilities.at(idx));
+      }
+    }
     // Test to make sure the tree linkage is intact
     if (common_robotics_utilities::simple_rrt_planner
             ::CheckTreeLinkage(pruned_planner_tree) == false)
@@ -1396,15 +2338,16 @@ protected:
     * Policy generation wrapper function
     */
   inline UncertaintyPlanningPolicy ExtractPolicy(
-      const UncertaintyPlanningTree& planner_tree, const Configuration& goal,
+      UncertaintyPlanningTree&& planner_tree, const Configuration& goal,
       const uint32_t planner_action_try_attempts,
       const uint32_t policy_action_attempt_count) const
   {
+    const ScopedPhaseTimer timer(policy_extraction_timing_);
     const double marginal_edge_weight = 0.05;
-    const UncertaintyPlanningPolicy policy(
-        planner_tree, goal, marginal_edge_weight, goal_probability_threshold_,
-        planner_action_try_attempts, policy_action_attempt_count, logging_fn_);
-    return policy;
+    return UncertaintyPlanningPolicy(
+        std::move(planner_tree), goal, marginal_edge_weight,
+        goal_probability_threshold_, planner_action_try_attempts,
+        policy_action_attempt_count, logging_fn_);
   }
 
   inline void LogParticleTrajectories(
@@ -2226,33 +3169,13 @@ protected:
     return markers;
   }
 
-  inline MarkerArray MakeParticlesDisplayRep(
-      const std::vector<SimulationResult<Configuration>>& particles,
-      const ColorRGBA& color, const std::string& ns) const
-  {
-    MarkerArray markers;
-    int32_t starting_idx = 1;
-    for (const auto& particle : particles)
-    {
-      const MarkerArray particle_markers
-          = simulator_ptr_->MakeConfigurationDisplayRep(
-              robot_ptr_, particle.ResultConfig(), color, starting_idx, ns);
-      markers.markers.insert(
-          markers.markers.end(),
-          particle_markers.markers.begin(),
-          particle_markers.markers.end());
-      starting_idx = static_cast<int32_t>(markers.markers.size() + 1);
-    }
-    return markers;
-  }
-
   /*
     * State sampling wrappers
     */
   inline UncertaintyPlanningState SampleRandomTargetState()
   {
     const Configuration random_point
-        = sampler_ptr_->Sample(simulator_ptr_->GetRandomGenerator());
+        = instance_pool_.GetThreadSampler().Sample(sampling_rng_);
     Log("Sampled config: "
         + common_robotics_utilities::print::Print(random_point), 0);
     const UncertaintyPlanningState random_state(random_point);
@@ -2262,13 +3185,29 @@ protected:
   inline UncertaintyPlanningState SampleRandomTargetGoalState()
   {
     const Configuration random_goal_point
-        = sampler_ptr_->SampleGoal(simulator_ptr_->GetRandomGenerator());
+        = instance_pool_.GetThreadSampler().SampleGoal(sampling_rng_);
     Log("Sampled goal config: "
         + common_robotics_utilities::print::Print(random_goal_point), 0);
     const UncertaintyPlanningState random_goal_state(random_goal_point);
     return random_goal_state;
   }
 
+  /*
+    * Sample a collision-free goal, e.g. as the virtual goal of a policy.
+    */
+  inline Configuration SampleValidGoal(PRNG& rng) const
+  {
+    while (true)
+    {
+      const Configuration goal_sample = sampler_ptr_->SampleGoal(rng);
+      if (simulator_ptr_->CheckConfigCollision(robot_ptr_, goal_sample)
+          == false)
+      {
+        return goal_sample;
+      }
+    }
+  }
+
   /*
     * Particle clustering function used in policy execution
     */
@@ -2280,10 +3219,9 @@ protected:
     {
       throw std::invalid_argument("parent_particles cannot be empty");
     }
-    std::vector<SimulationResult<Configuration>> result_particles;
-    result_particles.push_back(
-        SimulationResult<Configuration>(
-            current_config, current_config, false, false));
+    SimulationResultBatch<Configuration, ConfigAlloc> result_particles(
+        current_config);
+    result_particles.AddResult(current_config, false, false);
     const std::vector<uint8_t> cluster_membership
         = clustering_ptr_->IdentifyClusterMembers(
             robot_ptr_, parent_particles, result_particles, display_fn);
@@ -2299,57 +3237,50 @@ protected:
   }
 
   /*
-    * Particle clustering function for planning
+    * Particle clustering function for planning. Clusters are returned as
+    * indices into particles, so that particles are never copied.
     */
-  inline std::vector<std::vector<SimulationResult<Configuration>>>
-  ClusterParticles(
-      const std::vector<SimulationResult<Configuration>>& particles,
+  inline std::vector<std::vector<int64_t>> ClusterParticles(
+      const SimulationResultBatch<Configuration, ConfigAlloc>& particles,
       const bool allow_contacts, const DisplayFunction& display_fn)
   {
     // Make sure there are particles to cluster
-    if (particles.size() == 0)
+    if (particles.Size() == 0)
     {
-      return std::vector<std::vector<SimulationResult<Configuration>>>();
+      return std::vector<std::vector<int64_t>>();
     }
-    else if (particles.size() == 1)
+    else if (particles.Size() == 1)
     {
-      return std::vector<std::vector<SimulationResult<Configuration>>>
-          {particles};
+      return std::vector<std::vector<int64_t>>(1, std::vector<int64_t>(1, 0));
     }
-    const auto start = std::chrono::steady_clock::now();
-    const std::vector<std::vector<int64_t>> final_index_clusters
-        = clustering_ptr_->ClusterParticles(robot_ptr_, particles, display_fn);
-    // Before we return, we need to convert the index clusters to configuration
-    // clusters
-    std::vector<std::vector<SimulationResult<Configuration>>> final_clusters;
-    final_clusters.reserve(final_index_clusters.size());
+    const ScopedPhaseTimer timer(clustering_timing_);
+    std::vector<std::vector<int64_t>> final_clusters
+        = instance_pool_.GetThreadClustering().ClusterParticles(
+            robot_ptr_, particles, display_fn);
+    // Before we return, we need to remove particles that made contact, if
+    // contact is not allowed
     size_t total_particles = 0;
-    for (const auto& cluster : final_index_clusters)
+    for (auto& cluster : final_clusters)
     {
-      std::vector<SimulationResult<Configuration>> final_cluster;
-      final_cluster.reserve(cluster.size());
-      for (const int64_t particle_idx : cluster)
+      total_particles += cluster.size();
+      if (allow_contacts == false)
       {
-        total_particles++;
-        const SimulationResult<Configuration>& particle
-            = particles.at(static_cast<size_t>(particle_idx));
-        if ((particle.DidContact() == false) || allow_contacts)
-        {
-          final_cluster.push_back(particle);
-        }
+        cluster.erase(
+            std::remove_if(
+                cluster.begin(), cluster.end(),
+                [&] (const int64_t particle_idx)
+                {
+                  return particles.DidContact(
+                      static_cast<size_t>(particle_idx));
+                }),
+            cluster.end());
       }
-      final_cluster.shrink_to_fit();
-      final_clusters.push_back(final_cluster);
     }
-    final_clusters.shrink_to_fit();
-    if (total_particles != particles.size())
+    if (total_particles != particles.Size())
     {
-      throw std::runtime_error("total_particles != particles.size()");
+      throw std::runtime_error("total_particles != particles.Size()");
     }
     // Now, return the clusters and probability table
-    const auto end = std::chrono::steady_clock::now();
-    const std::chrono::duration<double> elapsed = end - start;
-    elapsed_clustering_time_ += elapsed.count();
     return final_clusters;
   }
 
@@ -2359,72 +3290,90 @@ protected:
   inline SimulateParticlesResult SimulateParticles(
       const UncertaintyPlanningState& nearest,
       const UncertaintyPlanningState& target, const bool allow_contacts,
-      const bool simulate_reverse, const DisplayFunction& display_fn)
+      const bool simulate_reverse, const uint64_t random_stream_key,
+      const DisplayFunction& display_fn)
   {
-      const auto start = std::chrono::steady_clock::now();
+      const ScopedPhaseTimer timer(simulation_timing_);
       // First, compute a target state
       const Configuration target_point = target.GetExpectation();
-      // Get the initial particles
-      ConfigVector initial_particles;
+      // Get the initial particles. Where possible, these are a view of the
+      // parent's particles (or a broadcast of its only particle), so they are
+      // not copied.
+      ConfigVector resampled_particles;
+      ParticleView<Configuration> initial_particles;
       // We'd like to use the particles of the parent directly
       if (nearest.GetNumParticles() == num_particles_)
       {
-        initial_particles = nearest.CollectParticles(num_particles_);
+        initial_particles = nearest.ViewParticles(num_particles_);
       }
       // If the number of particles is dynamic based on the simulator
       else if (num_particles_ == 0u)
       {
-        initial_particles = nearest.CollectParticles(nearest.GetNumParticles());
+        initial_particles = nearest.ViewParticles(nearest.GetNumParticles());
+      }
+      // If the parent has a single particle (or none), broadcast it
+      else if (nearest.GetNumParticles() <= 1)
+      {
+        initial_particles = nearest.ViewParticles(num_particles_);
       }
       // Otherwise, we resample from the parent
       else
       {
-        initial_particles = nearest.ResampleParticles(
-            num_particles_, simulator_ptr_->GetRandomGenerator());
+        Philox4x32PRNG resampling_rng(random_stream_key, 0u);
+        resampled_particles = nearest.ResampleParticles(
+            num_particles_, resampling_rng, particle_resampling_method_);
+        initial_particles
+            = ParticleView<Configuration>::Span(resampled_particles);
       }
       if (debug_level_ >= 15)
       {
         display_fn(MakeParticlesDisplayRep(
-            initial_particles, MakeColor(0.1f, 0.1f, 0.1f, 1.0f),
-            "initial_particles"));
+            initial_particles.template ToVector<ConfigAlloc>(),
+            MakeColor(0.1f, 0.1f, 0.1f, 1.0f), "initial_particles"));
       }
       // Forward propagate each of the particles
-      ConfigVector target_position;
-      target_position.reserve(1);
-      target_position.push_back(target_point);
-      target_position.shrink_to_fit();
+      const ParticleView<Configuration> target_position
+          = ParticleView<Configuration>::Broadcast(target_point, 1);
+      Simulator& simulator = instance_pool_.GetThreadSimulator();
+      simulator.SetRandomStreamKey(random_stream_key);
       std::vector<SimulationResult<Configuration>> propagated_points;
       if (simulate_reverse == false)
       {
-        propagated_points = simulator_ptr_->ForwardSimulateRobots(
+        propagated_points = simulator.ForwardSimulateParticles(
             robot_ptr_, initial_particles, target_position, allow_contacts,
             display_fn);
       }
       else
       {
-        propagated_points = simulator_ptr_->ReverseSimulateRobots(
+        propagated_points = simulator.ReverseSimulateParticles(
             robot_ptr_, initial_particles, target_position, allow_contacts,
             display_fn);
       }
       particles_simulated_ += propagated_points.size();
-      const auto end = std::chrono::steady_clock::now();
-      const std::chrono::duration<double> elapsed = end - start;
-      elapsed_simulation_time_ += elapsed.count();
-      return SimulateParticlesResult(initial_particles, propagated_points);
+      // Every particle was simulated towards the same target, so the results
+      // can be stored as a batch with a single actual target
+      SimulationResultBatch<Configuration, ConfigAlloc> simulated_particles
+          = SimulationResultBatch<Configuration, ConfigAlloc>::FromResults(
+              std::move(propagated_points));
+      return SimulateParticlesResult(std::move(simulated_particles));
   }
 
   inline std::pair<uint32_t, uint32_t> ComputeReverseEdgeProbability(
       const UncertaintyPlanningState& parent,
-      const UncertaintyPlanningState& child, const DisplayFunction& display_fn)
+      const UncertaintyPlanningState& child, const uint64_t random_stream_key,
+      const DisplayFunction& display_fn)
   {
-    const std::vector<SimulationResult<Configuration>> simulation_result
-        = SimulateParticles(child, parent, true, true, display_fn)
-            .SimulatedParticles();
+    const ScopedPhaseTimer timer(reverse_edge_check_timing_);
+    const SimulateParticlesResult reverse_simulation
+        = SimulateParticles(
+            child, parent, true, true, random_stream_key, display_fn);
+    const SimulationResultBatch<Configuration, ConfigAlloc>& simulation_result
+        = reverse_simulation.SimulatedParticles();
     std::vector<uint8_t> parent_cluster_membership;
     if (parent.HasParticles())
     {
       parent_cluster_membership
-          = clustering_ptr_->IdentifyClusterMembers(
+          = instance_pool_.GetThreadClustering().IdentifyClusterMembers(
               robot_ptr_, parent.GetParticlePositionsImmutable().Value(),
               simulation_result, display_fn);
     }
@@ -2432,7 +3381,7 @@ protected:
     {
       const ConfigVector parent_cluster(1, parent.GetExpectation());
       parent_cluster_membership
-          = clustering_ptr_->IdentifyClusterMembers(
+          = instance_pool_.GetThreadClustering().IdentifyClusterMembers(
               robot_ptr_, parent_cluster, simulation_result, display_fn);
     }
     uint32_t reached_parent = 0u;
@@ -2449,42 +3398,126 @@ protected:
         reached_parent);
   }
 
-  inline ForwardSimulateStatesResult ForwardSimulateStates(
+  /*
+    * Lazy reverse edge evaluation
+    */
+  inline void DeferPropagatedReverseEdgeCheck(
+      const uint64_t provisional_reverse_transition_id,
+      const uint64_t random_stream_key)
+  {
+    DeferredReverseEdgeCheck deferred_check;
+    deferred_check.reverse_target_index = -1;
+    deferred_check.random_stream_key = random_stream_key;
+    std::lock_guard<std::mutex> lock(deferred_reverse_edge_checks_mutex_);
+    propagated_reverse_edge_checks_[provisional_reverse_transition_id]
+        = deferred_check;
+  }
+
+  // Must be called before the provisional IDs of new_state are replaced.
+  inline void DeferMergedReverseEdgeCheck(
+      const int64_t new_state_idx, const UncertaintyPlanningState& new_state)
+  {
+    std::lock_guard<std::mutex> lock(deferred_reverse_edge_checks_mutex_);
+    const auto found_itr
+        = propagated_reverse_edge_checks_.find(
+            new_state.GetReverseTransitionId());
+    if (found_itr != propagated_reverse_edge_checks_.end())
+    {
+      DeferredReverseEdgeCheck deferred_check = found_itr->second;
+      deferred_check.reverse_target_index = merged_expansion_parent_index_;
+      deferred_reverse_edge_checks_[new_state_idx] = deferred_check;
+      propagated_reverse_edge_checks_.erase(found_itr);
+    }
+  }
+
+  /*
+    * Before a policy is extracted, perform the deferred reverse edge checks
+    * of every state that may be kept in it: states on a goal branch, and
+    * (with spur actions) their children, which may reverse to a goal branch.
+    */
+  inline void PerformPolicyReverseEdgeChecks(
+      const bool include_spur_actions, const DisplayFunction& display_fn)
+  {
+    auto deferred_itr = deferred_reverse_edge_checks_.begin();
+    while (deferred_itr != deferred_reverse_edge_checks_.end())
+    {
+      const int64_t state_index = deferred_itr->first;
+      const DeferredReverseEdgeCheck& deferred_check = deferred_itr->second;
+      UncertaintyPlanningTreeState& tree_state
+          = GetPlanningTreeMutable().at(static_cast<size_t>(state_index));
+      const UncertaintyPlanningState& parent_state
+          = GetPlanningTreeImmutable().at(static_cast<size_t>(
+              tree_state.GetParentIndex())).GetValueImmutable();
+      const bool may_be_kept
+          = (tree_state.GetValueImmutable().GetGoalPfeasibility() > 0.0)
+            || (include_spur_actions
+                && (parent_state.GetGoalPfeasibility() > 0.0));
+      if (!may_be_kept)
+      {
+        ++deferred_itr;
+        continue;
+      }
+      const UncertaintyPlanningState& reverse_target
+          = GetPlanningTreeImmutable().at(static_cast<size_t>(
+              deferred_check.reverse_target_index)).GetValueImmutable();
+      UncertaintyPlanningState& current_state = tree_state.GetValueMutable();
+      const std::pair<uint32_t, uint32_t> reverse_edge_check
+          = ComputeReverseEdgeProbability(
+              reverse_target, current_state, deferred_check.random_stream_key,
+              display_fn);
+      current_state.UpdateReverseAttemptAndReachedCounts(
+          reverse_edge_check.first, reverse_edge_check.second);
+      deferred_itr = deferred_reverse_edge_checks_.erase(deferred_itr);
+    }
+  }
+
+  inline UncertaintyPlanningStateForwardPropagation ForwardSimulateStates(
       const UncertaintyPlanningState& nearest,
       const UncertaintyPlanningState& target,
       const uint32_t planner_action_try_attempts, const bool allow_contacts,
-      const bool include_reverse_actions, const DisplayFunction& display_fn)
+      const bool include_reverse_actions, ExpansionContext& expansion,
+      const DisplayFunction& display_fn)
   {
-    // Increment the transition ID
-    transition_id_++;
-    const uint64_t current_forward_transition_id = transition_id_;
+    // Get a (provisional) transition ID
+    const uint64_t current_forward_transition_id = expansion.NextId();
     // Forward propagate each of the particles
-    const auto simulation_result
-        = SimulateParticles(nearest, target, allow_contacts, false, display_fn);
-    const auto& propagated_points = simulation_result.SimulatedParticles();
+    SimulateParticlesResult simulation_result
+        = SimulateParticles(
+            nearest, target, allow_contacts, false,
+            expansion.GetRandomStreamKey(current_forward_transition_id),
+            display_fn);
+    SimulationResultBatch<Configuration, ConfigAlloc>& propagated_points
+        = simulation_result.MutableSimulatedParticles();
     // Cluster the live particles into (potentially) multiple states
-    const auto& particle_clusters
+    const std::vector<std::vector<int64_t>> particle_clusters
         = ClusterParticles(propagated_points, allow_contacts, display_fn);
     bool is_split_child = false;
+    uint64_t current_split_id = 0u;
     if (particle_clusters.size() > 1)
     {
       is_split_child = true;
-      split_id_++;
+      current_split_id = expansion.NextId();
     }
     // Build the forward-propagated states
-    // We know in this case that all propagated points will have the same actual
-    // target, so we just use the first
-    const Configuration& control_target
-        = propagated_points.at(0).ActualTarget();
+    // All propagated points have the same actual target, which the batch
+    // stores once
+    const Configuration& control_target = propagated_points.ActualTarget();
     UncertaintyPlanningStateForwardPropagation result_states;
+    result_states.reserve(particle_clusters.size());
     for (size_t idx = 0; idx < particle_clusters.size(); idx++)
     {
-      const std::vector<SimulationResult<Configuration>>& current_cluster
-          = particle_clusters.at(idx);
+      const std::vector<int64_t>& current_cluster = particle_clusters.at(idx);
       if (debug_level_ >= 15)
       {
+        ConfigVector cluster_particles;
+        for (const int64_t particle_idx : current_cluster)
+        {
+          cluster_particles.push_back(
+              propagated_points.ResultConfig(
+                  static_cast<size_t>(particle_idx)));
+        }
         display_fn(MakeParticlesDisplayRep(
-            current_cluster,
+            cluster_particles,
             common_robotics_utilities::color_builder
                 ::LookupUniqueColor<ColorRGBA>(
                     static_cast<uint32_t>(idx + 1), 1.0f),
@@ -2492,26 +3525,29 @@ protected:
       }
       if (particle_clusters.at(idx).size() > 0)
       {
-        state_counter_++;
+        const uint64_t current_state_id = expansion.NextId();
         const uint32_t attempt_count
-            = static_cast<uint32_t>(propagated_points.size());
+            = static_cast<uint32_t>(propagated_points.Size());
         const uint32_t reached_count
             = static_cast<uint32_t>(current_cluster.size());
         // Check if any of the particles in the current cluster collided with
         // the environment during simulation. If all are collision-free, we can
-        // safely assume the edge is trivially reversible
-        ConfigVector particle_locations(current_cluster.size());
+        // safely assume the edge is trivially reversible. Each particle is in
+        // at most one cluster, so its result can be moved into the new state.
+        ConfigVector particle_locations;
+        particle_locations.reserve(current_cluster.size());
         bool did_collide = false;
         bool action_is_nominally_independent = true;
-        for (size_t pdx = 0; pdx < current_cluster.size(); pdx++)
+        for (const int64_t particle_idx : current_cluster)
         {
-          const auto& current_simulation_result = current_cluster.at(pdx);
-          particle_locations.at(pdx) = current_simulation_result.ResultConfig();
-          if (current_simulation_result.DidContact())
+          const size_t particle_index = static_cast<size_t>(particle_idx);
+          particle_locations.push_back(
+              std::move(propagated_points.MutableResultConfig(particle_index)));
+          if (propagated_points.DidContact(particle_index))
           {
             did_collide = true;
           }
-          if (current_simulation_result.OutcomeIsNominallyIndependent()
+          if (propagated_points.OutcomeIsNominallyIndependent(particle_index)
               == false)
           {
             action_is_nominally_independent = false;
@@ -2523,7 +3559,7 @@ protected:
         uint32_t reverse_reached_count
             = static_cast<uint32_t>(current_cluster.size());
         // Don't do extra work with one particle
-        if (did_collide && (propagated_points.size() > 1))
+        if (did_collide && (propagated_points.Size() > 1))
         {
           reverse_attempt_count
               = static_cast<uint32_t>(current_cluster.size());
@@ -2538,40 +3574,54 @@ protected:
         const double effective_edge_feasibility
             = static_cast<double>(reached_count)
                 / static_cast<double>(attempt_count);
-        transition_id_++;
-        const uint64_t new_state_reverse_transtion_id = transition_id_;
+        const uint64_t new_state_reverse_transtion_id = expansion.NextId();
         UncertaintyPlanningState propagated_state(
-            state_counter_, particle_locations, attempt_count, reached_count,
+            current_state_id, std::move(particle_locations), attempt_count,
+            reached_count,
             effective_edge_feasibility, reverse_attempt_count,
             reverse_reached_count, nearest.GetMotionPfeasibility(),
             step_size_, control_target, current_forward_transition_id,
-            new_state_reverse_transtion_id,
-            ((is_split_child) ? split_id_ : 0u),
+            new_state_reverse_transtion_id, current_split_id,
             action_is_nominally_independent);
         propagated_state.UpdateStatistics(robot_ptr_);
         // Store the state
-        result_states.emplace_back(propagated_state, -1);
+        result_states.emplace_back(std::move(propagated_state), -1);
       }
     }
     // Now that we've built the forward-propagated states, we compute their
     // reverse edge P(feasibility)
-    uint32_t computed_reversibility = 0u;
-    for (auto& current_propagated : result_states)
+    std::vector<size_t> reverse_check_indices;
+    uint32_t deferred_reversibility = 0u;
+    for (size_t idx = 0; idx < result_states.size(); idx++)
     {
       UncertaintyPlanningState& current_state
-          = current_propagated.MutableState();
+          = result_states.at(idx).MutableState();
       if (include_reverse_actions)
       {
         // In some cases, we already know the reverse edge P(feasibility) so we
         // don't need to compute it again
         if (current_state.GetReverseEdgePfeasibility() < 1.0)
         {
-          const std::pair<uint32_t, uint32_t> reverse_edge_check
-              = ComputeReverseEdgeProbability(
-                  nearest, current_state, display_fn);
-          current_state.UpdateReverseAttemptAndReachedCounts(
-              reverse_edge_check.first, reverse_edge_check.second);
-          computed_reversibility++;
+          // Reverse edge P(feasibility) only affects planning through the
+          // nominally independent outcomes of a split (see
+          // UpdateEstimatedEffectiveProbabilities()), so any other check can
+          // be deferred until a policy is extracted.
+          const bool reversibility_affects_planning
+              = (result_states.size() > 1)
+                && current_state.IsActionOutcomeNominallyIndependent();
+          if (lazy_reverse_edge_evaluation_
+              && !reversibility_affects_planning)
+          {
+            DeferPropagatedReverseEdgeCheck(
+                current_state.GetReverseTransitionId(),
+                expansion.GetRandomStreamKey(
+                    current_state.GetReverseTransitionId()));
+            deferred_reversibility++;
+          }
+          else
+          {
+            reverse_check_indices.push_back(idx);
+          }
         }
       }
       else
@@ -2580,9 +3630,68 @@ protected:
             static_cast<uint32_t>(current_state.GetNumParticles()), 0u);
       }
     }
+    const auto check_reverse_edge = [&] (const size_t state_index)
+    {
+      UncertaintyPlanningState& current_state
+          = result_states.at(state_index).MutableState();
+      const std::pair<uint32_t, uint32_t> reverse_edge_check
+          = ComputeReverseEdgeProbability(
+              nearest, current_state,
+              expansion.GetRandomStreamKey(
+                  current_state.GetReverseTransitionId()),
+              display_fn);
+      current_state.UpdateReverseAttemptAndReachedCounts(
+          reverse_edge_check.first, reverse_edge_check.second);
+    };
+    // The reverse edge checks of a split are independent, so they can run
+    // concurrently, each thread with its own simulator and clustering. Inside
+    // a batch of expansions (which already run concurrently), nested threads
+    // would not have instances of their own, so the checks run serially.
+    const bool check_concurrently
+        = concurrent_reverse_edge_checks_
+          && (reverse_check_indices.size() > 1)
+          && (instance_pool_.Size() > 1)
+          && !common_robotics_utilities::openmp_helpers::IsOmpInParallel();
+    if (check_concurrently)
+    {
+      const int32_t num_threads = static_cast<int32_t>(
+          std::min(instance_pool_.Size(), reverse_check_indices.size()));
+      std::vector<std::exception_ptr> reverse_check_errors(
+          reverse_check_indices.size());
+      #pragma omp parallel for schedule(dynamic) num_threads(num_threads)
+      for (size_t idx = 0; idx < reverse_check_indices.size(); idx++)
+      {
+        try
+        {
+          check_reverse_edge(reverse_check_indices.at(idx));
+        }
+        catch (...)
+        {
+          // Exceptions cannot leave an OpenMP parallel region
+          reverse_check_errors.at(idx) = std::current_exception();
+        }
+      }
+      for (const std::exception_ptr& reverse_check_error
+              : reverse_check_errors)
+      {
+        if (reverse_check_error)
+        {
+          std::rethrow_exception(reverse_check_error);
+        }
+      }
+    }
+    else
+    {
+      for (const size_t state_index : reverse_check_indices)
+      {
+        check_reverse_edge(state_index);
+      }
+    }
+    const size_t computed_reversibility = reverse_check_indices.size();
     Log("Forward simultation produced " + std::to_string(result_states.size())
         + " states, needed to compute reversibility for "
-        + std::to_string(computed_reversibility) + " of them",
+        + std::to_string(computed_reversibility) + " of them (deferred "
+        + std::to_string(deferred_reversibility) + ")",
         1);
     // We only do further processing if a split happened
     if (result_states.size() > 1)
@@ -2605,29 +3714,31 @@ protected:
       std::cout << "Press ENTER to add new states..." << std::endl;
       std::cin.get();
     }
-    return ForwardSimulateStatesResult(result_states, simulation_result);
+    return result_states;
   }
 
   inline UncertaintyPlanningStateForwardPropagation PropagateForwardsAndDraw(
       const UncertaintyPlanningState& nearest,
       const UncertaintyPlanningState& random,
       const uint32_t planner_action_try_attempts, const bool allow_contacts,
-      const bool include_reverse_actions, const DisplayFunction& display_fn)
+      const bool include_reverse_actions, const int64_t expansion_index,
+      const DisplayFunction& display_fn)
   {
     // First, perform the forwards propagation
-    const PerformForwardPropagationResult forward_propagated_states
+    ExpansionContext expansion(planning_random_seed_, expansion_index);
+    UncertaintyPlanningStateForwardPropagation forward_propagated_states
         = PerformForwardPropagation(
             nearest, random, planner_action_try_attempts, allow_contacts,
-            include_reverse_actions, display_fn);
+            include_reverse_actions, expansion, display_fn);
     if (debug_level_ >= 1)
     {
       // Draw the expansion
+      const Simulator& simulator = instance_pool_.GetThreadSimulator();
       MarkerArray propagation_display_rep;
       // Check if the expansion was useful
-      if (forward_propagated_states.CombinedForwardPropagations().size() > 0)
+      if (forward_propagated_states.size() > 0)
       {
-        for (const auto& forward_propagated_state
-                : forward_propagated_states.CombinedForwardPropagations())
+        for (const auto& forward_propagated_state : forward_propagated_states)
         {
           const UncertaintyPlanningState& current_state
               = forward_propagated_state.State();
@@ -2655,7 +3766,7 @@ protected:
               = (edge_Pfeasibility == 1.0)
                   ? "forward_expectation" : "split_forward_expectation";
           const MarkerArray forward_expectation_markers
-              = simulator_ptr_->MakeConfigurationDisplayRep(
+              = simulator.MakeConfigurationDisplayRep(
                   robot_ptr_, current_state.GetExpectation(), forward_color,
                   static_cast<int32_t>(
                       propagation_display_rep.markers.size() + 1),
@@ -2676,7 +3787,7 @@ protected:
                 = (edge_Pfeasibility == 1.0)
                     ? "reverse_expectation" : "split_reverse_expectation";
             const MarkerArray reverse_expectation_markers
-                = simulator_ptr_->MakeConfigurationDisplayRep(
+                = simulator.MakeConfigurationDisplayRep(
                     robot_ptr_, current_state.GetExpectation(), reverse_color,
                     static_cast<int32_t>(
                         propagation_display_rep.markers.size() + 1),
@@ -2690,14 +3801,15 @@ protected:
       }
       display_fn(propagation_display_rep);
     }
-    return forward_propagated_states.CombinedForwardPropagations();
+    return forward_propagated_states;
   }
 
-  inline PerformForwardPropagationResult PerformForwardPropagation(
+  inline UncertaintyPlanningStateForwardPropagation PerformForwardPropagation(
       const UncertaintyPlanningState& nearest,
       const UncertaintyPlanningState& random,
       const uint32_t planner_action_try_attempts, const bool allow_contacts,
-      const bool include_reverse_actions, const DisplayFunction& display_fn)
+      const bool include_reverse_actions, ExpansionContext& expansion,
+      const DisplayFunction& display_fn)
   {
     const bool solution_already_found
         = (total_goal_reached_probability_ >= goal_probability_threshold_);
@@ -2705,7 +3817,8 @@ protected:
     if (solution_already_found)
     {
       std::uniform_real_distribution<double> temp_dist(0.0, 1.0);
-      const double draw = temp_dist(simulator_ptr_->GetRandomGenerator());
+      Philox4x32PRNG expansion_rng = expansion.MakeExpansionRandomStream();
+      const double draw = temp_dist(expansion_rng);
       if (draw < connect_after_first_solution_)
       {
         use_extend = false;
@@ -2741,17 +3854,14 @@ protected:
             + ", target distance is " + std::to_string(target_distance), 0);
       }
       UncertaintyPlanningState target_state(target_point);
-      const ForwardSimulateStatesResult propagation_results
-          = ForwardSimulateStates(
-              nearest, target_state, planner_action_try_attempts,
-              allow_contacts, include_reverse_actions, display_fn);
-      return PerformForwardPropagationResult(propagation_results);
+      return ForwardSimulateStates(
+          nearest, target_state, planner_action_try_attempts, allow_contacts,
+          include_reverse_actions, expansion, display_fn);
     }
     // If we haven't found a solution yet, we use RRT-Connect
     else
     {
       UncertaintyPlanningStateForwardPropagation combined_forward_propagations;
-      std::vector<SimulateParticlesResult> step_particle_simulations;
       int64_t parent_offset = -1;
       // Compute a maximum number of steps to take
       const Configuration target_point = random.GetExpectation();
@@ -2762,7 +3872,9 @@ protected:
                   nearest.GetExpectation(), target_point)
               / step_size_)),
           1u);
-      UncertaintyPlanningState current = nearest;
+      // Only the expectation of the current state is needed to step towards
+      // the target, so avoid copying the whole state (and its particles).
+      Configuration current_expectation = nearest.GetExpectation();
       uint32_t steps = 0;
       bool completed = false;
       while (!completed && (steps < total_steps))
@@ -2771,13 +3883,13 @@ protected:
         Configuration current_target_point = target_point;
         const double target_distance
             = robot_ptr_->ComputeConfigurationDistance(
-                current.GetExpectation(), current_target_point);
+                current_expectation, current_target_point);
         if (target_distance > step_size_)
         {
           const double step_fraction = step_size_ / target_distance;
           const Configuration interpolated_target_point
               = robot_ptr_->InterpolateBetweenConfigurations(
-                  current.GetExpectation(), target_point, step_fraction);
+                  current_expectation, target_point, step_fraction);
           current_target_point = interpolated_target_point;
           Log("Forward simulating for " + std::to_string(step_fraction)
               + " step fraction, step size is " + std::to_string(step_size_)
@@ -2800,30 +3912,30 @@ protected:
         }
         // Take a step forwards
         UncertaintyPlanningState target_state(current_target_point);
-        const ForwardSimulateStatesResult propagation_results
+        UncertaintyPlanningStateForwardPropagation propagation_results
             = ForwardSimulateStates(
                 nearest, target_state, planner_action_try_attempts,
-                allow_contacts, include_reverse_actions, display_fn);
-        step_particle_simulations.push_back(
-            propagation_results.ParticleSimulations());
+                allow_contacts, include_reverse_actions, expansion,
+                display_fn);
         // If simulation results in a single new state, we keep going
-        if (propagation_results.ForwardPropagation().size() == 1)
+        if (propagation_results.size() == 1)
         {
-          auto propagated_state
-              = propagation_results.ForwardPropagation().at(0);
-          current = propagated_state.State();
+          PropagatedUncertaintyPlanningState& propagated_state
+              = propagation_results.at(0);
+          current_expectation = propagated_state.State().GetExpectation();
           propagated_state.SetRelativeParentIndex(parent_offset);
-          combined_forward_propagations.push_back(propagated_state);
+          combined_forward_propagations.push_back(std::move(propagated_state));
           parent_offset++;
           steps++;
         }
         // If simulation results in multiple new states, this is the end
-        else if (propagation_results.ForwardPropagation().size() > 1)
+        else if (propagation_results.size() > 1)
         {
-          for (auto propagated_state : propagation_results.ForwardPropagation())
+          for (auto& propagated_state : propagation_results)
           {
             propagated_state.SetRelativeParentIndex(parent_offset);
-            combined_forward_propagations.push_back(propagated_state);
+            combined_forward_propagations.push_back(
+                std::move(propagated_state));
           }
           completed = true;
         }
@@ -2833,8 +3945,7 @@ protected:
           completed = true;
         }
       }
-      return PerformForwardPropagationResult(
-          combined_forward_propagations, step_particle_simulations);
+      return combined_forward_propagations;
     }
   }
 
@@ -2952,6 +4063,7 @@ protected:
   {
     UncertaintyPlanningTreeState& new_goal
         = tree.at(static_cast<size_t>(new_goal_state_idx));
+    transition_children_index_.Update(GetPlanningTreeImmutable());
     // Update the time-to-first-solution if need be
     if (time_to_first_solution_ == 0.0)
     {
@@ -2997,14 +4109,12 @@ protected:
     int64_t probability_update_index = new_goal.GetParentIndex();
     while (probability_update_index >= 0)
     {
-      // Get the current state that we're looking at
-      UncertaintyPlanningTreeState& current_state
-          = GetPlanningTreeMutable().at(static_cast<size_t>(
-              probability_update_index));
       // Update the state
       UpdateNodeGoalReachedProbability(
-          current_state, planner_action_try_attempts);
-      probability_update_index = current_state.GetParentIndex();
+          probability_update_index, planner_action_try_attempts);
+      probability_update_index
+          = GetPlanningTreeImmutable().at(static_cast<size_t>(
+              probability_update_index)).GetParentIndex();
     }
     // Get the goal reached probability that we use to decide when we're done
     total_goal_reached_probability_
@@ -3027,18 +4137,26 @@ protected:
     }
     else
     {
-      // Get the current node
-      auto& current_state = GetPlanningTreeMutable().at(static_cast<size_t>(
-          goal_branch_root_index));
-      // Recursively blacklist it
-      current_state.GetValueMutable().DisableForNearestNeighbors();
-      // Blacklist each child
-      const std::vector<int64_t>& child_indices
-          = current_state.GetChildIndices();
-      for (const int64_t child_index : child_indices)
-      {
-        BlacklistGoalBranch(child_index);
-      }
+      // Blacklist every state in the goal branch
+      TraverseDepthFirst(
+          goal_branch_root_index,
+          [&] (const int64_t state_index)
+          {
+            return ChildIndexRange(
+                GetPlanningTreeImmutable().at(static_cast<size_t>(state_index))
+                    .GetChildIndices());
+          },
+          [&] (const int64_t state_index)
+          {
+            GetPlanningTreeMutable().at(static_cast<size_t>(state_index))
+                .GetValueMutable().DisableForNearestNeighbors();
+            if (state_index
+                < static_cast<int64_t>(nearest_neighbors_cache_.Size()))
+            {
+              nearest_neighbors_cache_.DisableState(state_index);
+            }
+            return true;
+          });
     }
   }
 
@@ -3073,18 +4191,18 @@ protected:
       else
       {
         bool other_children_blacklisted = true;
-        const std::vector<int64_t>& other_parent_children
-            = parent_tree_state.GetChildIndices();
-        for (const int64_t other_child_index : other_parent_children)
+        const std::vector<int64_t>& other_transition_children
+            = transition_children_index_.GetTransitionChildIndices(
+                state.GetParentIndex(),
+                state.GetValueImmutable().GetTransitionId());
+        for (const int64_t other_child_index : other_transition_children)
         {
           const UncertaintyPlanningTreeState& other_child_tree_state
               = GetPlanningTreeImmutable().at(static_cast<size_t>(
                   other_child_index));
           const UncertaintyPlanningState& other_child_state
               = other_child_tree_state.GetValueImmutable();
-          if (other_child_state.GetTransitionId()
-              == state.GetValueImmutable().GetTransitionId()
-              && other_child_state.UseForNearestNeighbors())
+          if (other_child_state.UseForNearestNeighbors())
           {
             other_children_blacklisted = false;
           }
@@ -3114,7 +4232,7 @@ protected:
   }
 
   inline void UpdateNodeGoalReachedProbability(
-      UncertaintyPlanningTreeState& current_node,
+      const int64_t current_node_index,
       const uint32_t planner_action_try_attempts)
   {
     // Check all the children of the current node, and update the node's goal
@@ -3132,27 +4250,16 @@ protected:
     // (split goal probability * probability of split).
     //
     // We can identify split nodes as children which share a transition id.
-    // First, we go through the children and separate them based on transition
-    // id (this puts all the children of a split together in one place).
-    std::map<uint64_t, std::vector<int64_t>> effective_child_branches;
-    for (const int64_t current_child_index : current_node.GetChildIndices())
-    {
-      const uint64_t& child_transition_id
-          = GetPlanningTreeImmutable()
-              .at(static_cast<size_t>(current_child_index))
-                  .GetValueImmutable().GetTransitionId();
-      effective_child_branches[child_transition_id].push_back(
-          current_child_index);
-    }
-    // Now that we have the transitions separated out, compute the goal
-    // probability of each transition.
+    // The transition children index keeps the children of each node grouped
+    // by transition id (this puts all the children of a split together in one
+    // place), so compute the goal probability of each transition.
     std::vector<double> effective_child_branch_probabilities;
-    for (auto itr = effective_child_branches.begin();
-         itr != effective_child_branches.end(); ++itr)
+    for (const TransitionChildren& transition
+            : transition_children_index_.GetTransitions(current_node_index))
     {
       const double transition_goal_probability
           = ComputeTransitionGoalProbability(
-              itr->second, planner_action_try_attempts);
+              transition.ChildIndices(), planner_action_try_attempts);
       effective_child_branch_probabilities.push_back(
           transition_goal_probability);
     }
@@ -3172,26 +4279,131 @@ protected:
           "max_transition_probability out of range [0, 1]");
     }
     // Update the current state
-    current_node.GetValueMutable().SetGoalPfeasibility(
-        max_transition_probability);
+    GetPlanningTreeMutable().at(static_cast<size_t>(current_node_index))
+        .GetValueMutable().SetGoalPfeasibility(max_transition_probability);
   }
 
   inline double ComputeTransitionGoalProbability(
       const std::vector<int64_t>& child_node_indices,
       const uint32_t planner_action_try_attempts) const
   {
-    UncertaintyPlanningStateVector child_states(child_node_indices.size());
-    for (size_t idx = 0; idx < child_node_indices.size(); idx++)
+    // I don't know why this needs the return type declared, but it does.
+    const std::function<const UncertaintyPlanningState&(const int64_t)>
+        get_planning_state_fn
+            = [&] (const int64_t state_index) -> const UncertaintyPlanningState&
     {
-      // Get the current child
-      const int64_t& current_child_index = child_node_indices[idx];
-      const UncertaintyPlanningState& current_child
-          = GetPlanningTreeImmutable()
-              .at(static_cast<size_t>(current_child_index)).GetValueImmutable();
-      child_states.at(idx) = current_child;
-    }
+      return GetPlanningTreeImmutable().at(static_cast<size_t>(state_index))
+          .GetValueImmutable();
+    };
     return UncertaintyPlanningPolicy::ComputeTransitionGoalProbability(
-        child_states, planner_action_try_attempts, logging_fn_);
+        get_planning_state_fn, child_node_indices, planner_action_try_attempts,
+        logging_fn_);
+  }
+
+  /*
+    * Per-phase timing statistics
+    */
+  inline void ResetPhaseTimingStatistics()
+  {
+    sampling_timing_.Reset();
+    nearest_neighbors_timing_.Reset();
+    forward_propagation_timing_.Reset();
+    simulation_timing_.Reset();
+    clustering_timing_.Reset();
+    reverse_edge_check_timing_.Reset();
+    state_added_timing_.Reset();
+    goal_check_timing_.Reset();
+    goal_reached_callback_timing_.Reset();
+    post_processing_timing_.Reset();
+    pruning_timing_.Reset();
+    policy_extraction_timing_.Reset();
+  }
+
+  inline void AddPhaseTimingStatistics(
+      std::map<std::string, double>& statistics) const
+  {
+    sampling_timing_.AddToStatistics("phase_sampling", statistics);
+    nearest_neighbors_timing_.AddToStatistics(
+        "phase_nearest_neighbors", statistics);
+    forward_propagation_timing_.AddToStatistics(
+        "phase_forward_propagation", statistics);
+    simulation_timing_.AddToStatistics("phase_simulation", statistics);
+    clustering_timing_.AddToStatistics("phase_clustering", statistics);
+    reverse_edge_check_timing_.AddToStatistics(
+        "phase_reverse_edge_check", statistics);
+    state_added_timing_.AddToStatistics("phase_state_added", statistics);
+    goal_check_timing_.AddToStatistics("phase_goal_check", statistics);
+    goal_reached_callback_timing_.AddToStatistics(
+        "phase_goal_reached_callback", statistics);
+    post_processing_timing_.AddToStatistics(
+        "phase_post_processing", statistics);
+    pruning_timing_.AddToStatistics("phase_pruning", statistics);
+    policy_extraction_timing_.AddToStatistics(
+        "phase_policy_extraction", statistics);
+  }
+
+  /*
+    * Anytime policy snapshots
+    */
+  inline bool PolicySnapshotDue() const
+  {
+    if (!policy_snapshot_callback_ || policy_snapshot_worker_.Busy())
+    {
+      return false;
+    }
+    // Only publish a new snapshot if it improves P(goal reached)
+    if (total_goal_reached_probability_
+            < policy_snapshot_goal_reached_probability_threshold_
+        || total_goal_reached_probability_
+            <= last_snapshot_goal_reached_probability_)
+    {
+      return false;
+    }
+    const std::chrono::duration<double> elapsed
+        = std::chrono::steady_clock::now() - last_snapshot_time_;
+    return (elapsed >= policy_snapshot_interval_);
+  }
+
+  inline void PublishPolicySnapshot(
+      const Configuration& virtual_goal_config,
+      const uint32_t edge_attempt_count,
+      const uint32_t policy_action_attempt_count,
+      const bool include_spur_actions, const DisplayFunction& display_fn)
+  {
+    Log("Publishing policy snapshot with goal reached probability "
+        + std::to_string(total_goal_reached_probability_), 1);
+    // Snapshots are not allocated from the session arena, so that published
+    // policies do not keep its chunks alive.
+    const SessionArenaScope heap_scope(nullptr);
+    PerformPolicyReverseEdgeChecks(include_spur_actions, display_fn);
+    // Only the pruned tree is copied here, so that planning can continue
+    // while the policy is extracted from it.
+    transition_children_index_.Update(GetPlanningTreeImmutable());
+    const std::vector<double> postprocessed_goal_probabilities
+        = PostProcessTree(
+            GetPlanningTreeImmutable(), transition_children_index_);
+    const std::shared_ptr<UncertaintyPlanningTree> pruned_tree_ptr
+        = std::make_shared<UncertaintyPlanningTree>(
+            PruneTree(
+                GetPlanningTreeImmutable(), postprocessed_goal_probabilities,
+                include_spur_actions));
+    const std::shared_ptr<const Configuration> virtual_goal_ptr
+        = std::allocate_shared<Configuration>(
+            Eigen::aligned_allocator<Configuration>(), virtual_goal_config);
+    const double goal_reached_probability = total_goal_reached_probability_;
+    const PolicySnapshotCallback snapshot_callback = policy_snapshot_callback_;
+    last_snapshot_goal_reached_probability_ = goal_reached_probability;
+    last_snapshot_time_ = std::chrono::steady_clock::now();
+    policy_snapshot_worker_.Start([=] ()
+    {
+      const std::shared_ptr<const UncertaintyPlanningPolicy> policy
+          = std::allocate_shared<UncertaintyPlanningPolicy>(
+              Eigen::aligned_allocator<UncertaintyPlanningPolicy>(),
+              ExtractPolicy(
+                  std::move(*pruned_tree_ptr), *virtual_goal_ptr,
+                  edge_attempt_count, policy_action_attempt_count));
+      snapshot_callback(policy, goal_reached_probability);
+    });
   }
 
   /*
@@ -3200,7 +4412,7 @@ protected:
   inline bool PlannerTerminationCheck(
       const std::chrono::time_point<std::chrono::steady_clock>& start_time,
       const std::chrono::duration<double>& time_limit,
-      const double p_goal_termination_threshold) const
+      const double p_goal_termination_threshold)
   {
     const std::chrono::time_point<std::chrono::steady_clock> now_time
         = std::chrono::steady_clock::now();
@@ -3208,6 +4420,7 @@ protected:
     if (time_limit_reached)
     {
       Log("Terminating, reached time limit", 0);
+      termination_reason_ = PlannerTerminationReason::TIME_LIMIT;
       return true;
     }
     else if (p_goal_termination_threshold > 0.0)
@@ -3217,10 +4430,66 @@ protected:
       if (p_goal_gap <= 1e-10)
       {
         Log("Terminating, reached p_goal_termination_threshold", 0);
+        termination_reason_
+            = PlannerTerminationReason::GOAL_PROBABILITY_THRESHOLD;
         return true;
       }
     }
+    if (ConvergenceTerminationCheck())
+    {
+      Log("Terminating, P(goal reached) has converged", 0);
+      termination_reason_
+          = PlannerTerminationReason::GOAL_PROBABILITY_CONVERGED;
+      return true;
+    }
     return false;
   }
+
+  /*
+    * Called once per planner iteration, returns true if P(goal reached) has
+    * improved by less than the minimum gain over the convergence window.
+    */
+  inline bool ConvergenceTerminationCheck()
+  {
+    const uint64_t iteration = convergence_iterations_;
+    convergence_iterations_++;
+    // Convergence is only measured once a solution has been found
+    if (convergence_min_goal_reached_probability_gain_ <= 0.0
+        || total_goal_reached_probability_ <= 0.0)
+    {
+      return false;
+    }
+    ConvergenceSample sample;
+    sample.iteration = iteration;
+    sample.particles_simulated = particles_simulated_.load();
+    sample.goal_reached_probability = total_goal_reached_probability_;
+    convergence_history_.push_back(sample);
+    const auto window_covered
+        = [&] (const ConvergenceSample& window_start)
+    {
+      return ((sample.iteration - window_start.iteration)
+                  >= convergence_iteration_window_)
+             && ((sample.particles_simulated
+                  - window_start.particles_simulated)
+                     >= convergence_particle_window_);
+    };
+    // Keep the shortest window that still covers the required work (and
+    // starts before this iteration)
+    while (convergence_history_.size() >= 3
+           && window_covered(convergence_history_.at(1)))
+    {
+      convergence_history_.pop_front();
+    }
+    if (convergence_history_.size() < 2
+        || !window_covered(convergence_history_.front()))
+    {
+      return false;
+    }
+    const double goal_reached_probability_gain
+        = sample.goal_reached_probability
+          - convergence_history_.front().goal_reached_probability;
+    return (goal_reached_probability_gain
+            < convergence_min_goal_reached_probability_gain_);
+  }
 };
 }  // namespace uncertainty_planning_core
@@ -8,6 +8,7 @@
 #include <iostream>
 #include <stdexcept>
 #include <functional>
+#include <algorithm>
 #include <random>
 #include <memory>
 #include <common_robotics_utilities/maybe.hpp>
@@ -15,9 +16,65 @@
 #include <common_robotics_utilities/math.hpp>
 #include <common_robotics_utilities/serialization.hpp>
 #include <common_robotics_utilities/simple_robot_model_interface.hpp>
+#include <uncertainty_planning_core/particle_view.hpp>
 
 namespace uncertainty_planning_core
 {
+/// Methods to resample N equally-weighted particles into M particles, all of
+/// which take O(N + M) time. MULTINOMIAL draws every particle independently.
+/// SYSTEMATIC and STRATIFIED split [0, 1) into M evenly-spaced strata and draw
+/// one particle from each, using a single shared offset or an independent
+/// offset per stratum, respectively. RESIDUAL copies every particle
+/// floor(M / N) times, then draws the remaining particles multinomially. The
+/// stratified methods have lower resampling variance than MULTINOMIAL.
+enum class ParticleResamplingMethod : uint8_t
+{
+  MULTINOMIAL = 0x00,
+  SYSTEMATIC = 0x01,
+  STRATIFIED = 0x02,
+  RESIDUAL = 0x03
+};
+
+inline std::string ParticleResamplingMethodToString(
+    const ParticleResamplingMethod method)
+{
+  switch (method)
+  {
+    case ParticleResamplingMethod::MULTINOMIAL:
+      return "multinomial";
+    case ParticleResamplingMethod::SYSTEMATIC:
+      return "systematic";
+    case ParticleResamplingMethod::STRATIFIED:
+      return "stratified";
+    case ParticleResamplingMethod::RESIDUAL:
+      return "residual";
+  }
+  throw std::invalid_argument("Invalid ParticleResamplingMethod");
+}
+
+inline ParticleResamplingMethod ParticleResamplingMethodFromString(
+    const std::string& method)
+{
+  if (method == "multinomial")
+  {
+    return ParticleResamplingMethod::MULTINOMIAL;
+  }
+  else if (method == "systematic")
+  {
+    return ParticleResamplingMethod::SYSTEMATIC;
+  }
+  else if (method == "stratified")
+  {
+    return ParticleResamplingMethod::STRATIFIED;
+  }
+  else if (method == "residual")
+  {
+    return ParticleResamplingMethod::RESIDUAL;
+  }
+  throw std::invalid_argument(
+      "Invalid particle resampling method [" + method + "]");
+}
+
 template<typename Configuration, typename ConfigSerializer,
          typename ConfigAlloc=std::allocator<Configuration>>
 class UncertaintyPlannerState
@@ -404,7 +461,7 @@ public:
 
   UncertaintyPlannerState(
       const uint64_t state_id,
-      const std::vector<Configuration, ConfigAlloc>& particles,
+      std::vector<Configuration, ConfigAlloc> particles,
       const uint32_t attempt_count, const uint32_t reached_count,
       const double effective_edge_Pfeasibility,
       const uint32_t reverse_attempt_count,
@@ -416,7 +473,7 @@ public:
   {
       state_id_ = state_id;
       step_size_ = step_size;
-      particles_ = particles;
+      particles_ = std::move(particles);
       attempt_count_ = attempt_count;
       reached_count_ = reached_count;
       reverse_attempt_count_ = reverse_attempt_count;
@@ -466,13 +523,12 @@ public:
       };
       expectation_ = ComputeExpectation(average_fn);
       variance_ = ComputeVariance(expectation_, distance_fn);
-      variances_ = ComputeDirectionalVariance(expectation_, dim_distance_fn);
       space_independent_variance_
           = ComputeSpaceIndependentVariance(
               expectation_, distance_fn, step_size_);
-      space_independent_variances_
-          = ComputeSpaceIndependentDirectionalVariance(
-              expectation_, dim_distance_fn, step_size_);
+      ComputeDirectionalVariances(
+          expectation_, dim_distance_fn, step_size_, variances_,
+          space_independent_variances_);
   }
 
   inline UncertaintyPlannerState()
@@ -590,6 +646,16 @@ public:
 
   uint64_t GetSplitId() const { return split_id_; }
 
+  void SetStateAndTransitionIds(
+      const uint64_t state_id, const uint64_t transition_id,
+      const uint64_t reverse_transition_id, const uint64_t split_id)
+  {
+    state_id_ = state_id;
+    transition_id_ = transition_id;
+    reverse_transition_id_ = reverse_transition_id;
+    split_id_ = split_id;
+  }
+
   const Configuration& GetCommand() const { return command_; }
 
   void SetCommand(const Configuration& command) { command_ = command; }
@@ -656,9 +722,42 @@ public:
     }
   }
 
+  /// Same as CollectParticles(), but returns a view of the stored particles
+  /// (or a broadcast of the only particle or the expectation) instead of a
+  /// copy. The view is only valid as long as this state is not modified.
+  ParticleView<Configuration> ViewParticles(const size_t num_particles) const
+  {
+    if (particles_.size() == 0)
+    {
+      return ParticleView<Configuration>::Broadcast(
+          expectation_, num_particles);
+    }
+    else if (particles_.size() == 1)
+    {
+      return ParticleView<Configuration>::Broadcast(
+          particles_[0], num_particles);
+    }
+    else
+    {
+      if (num_particles == particles_.size())
+      {
+        return ParticleView<Configuration>::Span(particles_);
+      }
+      else
+      {
+        throw std::invalid_argument(
+            "ViewParticles() called with particles_.size() > 1, and"
+            " num_particles != particles_.size(). You must use"
+            " ResampleParticles() instead.");
+      }
+    }
+  }
+
   template<typename RNG>
   std::vector<Configuration, ConfigAlloc> ResampleParticles(
-      const size_t num_particles, RNG& rng) const
+      const size_t num_particles, RNG& rng,
+      const ParticleResamplingMethod method
+          = ParticleResamplingMethod::MULTINOMIAL) const
   {
     if (particles_.size() == 0)
     {
@@ -672,23 +771,61 @@ public:
     }
     else
     {
-      std::vector<Configuration, ConfigAlloc> resampled_particles(
-          num_particles);
-      double particle_probability
-          = 1.0 / static_cast<double>(particles_.size());
+      std::vector<Configuration, ConfigAlloc> resampled_particles;
+      resampled_particles.reserve(num_particles);
+      const size_t num_stored = particles_.size();
       std::uniform_int_distribution<size_t> resampling_distribution(
-          0, particles_.size() - 1);
-      std::uniform_real_distribution<double> importance_sampling_distribution(
-          0.0, 1.0);
-      size_t resampled = 0;
-      while (resampled < num_particles)
+          0, num_stored - 1);
+      std::uniform_real_distribution<double> stratum_distribution(0.0, 1.0);
+      // Particles are equally weighted, so the particle at cumulative
+      // probability p is simply particles_[floor(p * num_stored)].
+      const auto particle_at = [&] (const double cumulative_probability)
+          -> const Configuration&
+      {
+        const size_t index = static_cast<size_t>(
+            cumulative_probability * static_cast<double>(num_stored));
+        return particles_[std::min(index, num_stored - 1)];
+      };
+      const double stratum_size = 1.0 / static_cast<double>(num_particles);
+      if (method == ParticleResamplingMethod::SYSTEMATIC)
+      {
+        const double offset = stratum_distribution(rng);
+        for (size_t idx = 0; idx < num_particles; idx++)
+        {
+          resampled_particles.push_back(particle_at(
+              (static_cast<double>(idx) + offset) * stratum_size));
+        }
+      }
+      else if (method == ParticleResamplingMethod::STRATIFIED)
       {
-        size_t random_index = resampling_distribution(rng);
-        const Configuration& random_particle = particles_[random_index];
-        if (importance_sampling_distribution(rng) < particle_probability)
+        for (size_t idx = 0; idx < num_particles; idx++)
         {
-          resampled_particles[resampled] = random_particle;
-          resampled++;
+          const double offset = stratum_distribution(rng);
+          resampled_particles.push_back(particle_at(
+              (static_cast<double>(idx) + offset) * stratum_size));
+        }
+      }
+      else
+      {
+        if (method == ParticleResamplingMethod::RESIDUAL)
+        {
+          const size_t copies_per_particle = num_particles / num_stored;
+          for (size_t idx = 0; idx < num_stored; idx++)
+          {
+            resampled_particles.insert(
+                resampled_particles.end(), copies_per_particle,
+                particles_[idx]);
+          }
+        }
+        else if (method != ParticleResamplingMethod::MULTINOMIAL)
+        {
+          throw std::invalid_argument("Invalid ParticleResamplingMethod");
+        }
+        // With equal weights, the residual weights are also equal
+        while (resampled_particles.size() < num_particles)
+        {
+          resampled_particles.push_back(
+              particles_[resampling_distribution(rng)]);
         }
       }
       return resampled_particles;
@@ -783,73 +920,72 @@ public:
     }
   }
 
-  Eigen::VectorXd ComputeDirectionalVariance(
+  /// Computes both the directional variance and the space-independent
+  /// directional variance, in a single pass over the particles.
+  void ComputeDirectionalVariances(
       const Configuration& expectation,
       const std::function<Eigen::VectorXd(
-          const Configuration&, const Configuration&)>& dim_distance_fn) const
+          const Configuration&, const Configuration&)>& dim_distance_fn,
+      const double step_size, Eigen::VectorXd& variances,
+      Eigen::VectorXd& space_independent_variances) const
   {
     if (particles_.size() == 0)
     {
-      return dim_distance_fn(expectation, expectation);
+      variances = dim_distance_fn(expectation, expectation);
+      space_independent_variances = variances;
     }
     else if (particles_.size() == 1)
     {
-      return dim_distance_fn(particles_[0], particles_[0]);
+      variances = dim_distance_fn(particles_[0], particles_[0]);
+      space_independent_variances = variances;
     }
     else
     {
       const double weight = 1.0 / static_cast<double>(particles_.size());
-      Eigen::VectorXd variances;
+      variances.resize(0);
+      space_independent_variances.resize(0);
       for (size_t idx = 0; idx < particles_.size(); idx++)
       {
         const Eigen::VectorXd error
             = dim_distance_fn(expectation, particles_[idx]);
-        const Eigen::VectorXd squared_error = error.cwiseProduct(error);
-        const Eigen::VectorXd weighted_squared_error = squared_error * weight;
-        if (variances.size() != weighted_squared_error.size())
+        if (variances.size() != error.size())
         {
-          variances.setZero(weighted_squared_error.size());
+          variances.setZero(error.size());
+          space_independent_variances.setZero(error.size());
         }
-        variances += weighted_squared_error;
+        // Accumulate directly, without allocating temporaries
+        variances += error.cwiseProduct(error) * weight;
+        space_independent_variances
+            += (error / step_size).cwiseProduct(error / step_size) * weight;
       }
-      return variances;
     }
   }
 
+  Eigen::VectorXd ComputeDirectionalVariance(
+      const Configuration& expectation,
+      const std::function<Eigen::VectorXd(
+          const Configuration&, const Configuration&)>& dim_distance_fn) const
+  {
+    Eigen::VectorXd variances;
+    Eigen::VectorXd space_independent_variances;
+    ComputeDirectionalVariances(
+        expectation, dim_distance_fn, 1.0, variances,
+        space_independent_variances);
+    return variances;
+  }
+
   Eigen::VectorXd ComputeSpaceIndependentDirectionalVariance(
       const Configuration& expectation,
       const std::function<Eigen::VectorXd(
           const Configuration&, const Configuration&)>& dim_distance_fn,
       const double step_size) const
   {
-    if (particles_.size() == 0)
-    {
-      return dim_distance_fn(expectation, expectation);
-    }
-    else if (particles_.size() == 1)
-    {
-      return dim_distance_fn(particles_[0], particles_[0]);
-    }
-    else
-    {
-      const double weight = 1.0 / static_cast<double>(particles_.size());
-      Eigen::VectorXd variances;
-      for (size_t idx = 0; idx < particles_.size(); idx++)
-      {
-        const Eigen::VectorXd error
-            = dim_distance_fn(expectation, particles_[idx]);
-        const Eigen::VectorXd space_independent_error = error / step_size;
-        const Eigen::VectorXd squared_error
-            = space_independent_error.cwiseProduct(space_independent_error);
-        const Eigen::VectorXd weighted_squared_error = squared_error * weight;
-        if (variances.size() != weighted_squared_error.size())
-        {
-          variances.setZero(weighted_squared_error.size());
-        }
-        variances += weighted_squared_error;
-      }
-      return variances;
-    }
+    Eigen::VectorXd variances;
+    Eigen::VectorXd space_independent_variances;
+    ComputeDirectionalVariances(
+        expectation, dim_distance_fn, step_size, variances,
+        space_independent_variances);
+    return space_independent_variances;
   }
 
   std::string Print() const
@@ -17,9 +17,14 @@
 #include <common_robotics_utilities/utility.hpp>
 #include <common_robotics_utilities/simple_robot_model_interface.hpp>
 #include <common_robotics_utilities/zlib_helpers.hpp>
+#include <uncertainty_planning_core/caching_simulator.hpp>
 #include <uncertainty_planning_core/execution_policy.hpp>
+#include <uncertainty_planning_core/parallel_particle_simulator.hpp>
+#include <uncertainty_planning_core/recording_simulator.hpp>
 #include <uncertainty_planning_core/ros_integration.hpp>
+#include <uncertainty_planning_core/session_arena_allocator.hpp>
 #include <uncertainty_planning_core/simple_simulator_interface.hpp>
+#include <uncertainty_planning_core/simulation_result_batch.hpp>
 #include <uncertainty_planning_core/uncertainty_planner_state.hpp>
 #include <uncertainty_planning_core/uncertainty_contact_planning.hpp>
 
@@ -31,12 +36,23 @@ struct PLANNING_AND_EXECUTION_OPTIONS
   double planner_time_limit = 0.0;
   // P(goal reached) termination threshold
   double p_goal_reached_termination_threshold = 0.0;
+  // Terminate once P(goal reached) improves by less than this over the
+  // convergence window (0 disables convergence-based termination). If it is
+  // enabled, the particle window, the iteration window, or both must be > 0.
+  double p_goal_reached_convergence_threshold = 0.0;
+  uint32_t p_goal_reached_convergence_particle_window = 0u;
+  uint32_t p_goal_reached_convergence_iteration_window = 0u;
   // Standard planner control params
   double goal_bias = 0.0;
   double step_size = 0.0;
   double goal_probability_threshold = 0.0;
   double goal_distance_threshold = 0.0;
   double connect_after_first_solution = 0.0;
+  // Number of samples expanded concurrently per planner iteration
+  uint32_t expansion_batch_size = 1u;
+  // Skip expansions towards targets within this distance of a target their
+  // nearest state was already expanded towards (negative disables skipping)
+  double repeated_expansion_tolerance = -1.0;
   // Distance function control params/weights
   double feasibility_alpha = 0.0;
   double variance_alpha = 0.0;
@@ -44,6 +60,9 @@ struct PLANNING_AND_EXECUTION_OPTIONS
   uint32_t edge_attempt_count = 0u;
   // Particle/execution limits
   uint32_t num_particles = 0u;
+  // How particles are resampled from states with more than one particle
+  ParticleResamplingMethod particle_resampling_method
+      = ParticleResamplingMethod::MULTINOMIAL;
   // Execution limits
   uint32_t num_policy_simulations = 0u;
   uint32_t num_policy_executions = 0u;
@@ -56,6 +75,13 @@ struct PLANNING_AND_EXECUTION_OPTIONS
   int32_t debug_level = 0;
   bool use_contact = false;
   bool use_reverse = false;
+  // Only compute reverse edge P(feasibility) where it affects the policy
+  bool use_lazy_reverse = false;
+  // Check the reverse edges of split outcomes concurrently
+  bool use_concurrent_reverse = false;
+  // Index the planning tree for nearest neighbors (only valid if the robot's
+  // configuration distance is a metric)
+  bool use_nearest_neighbors_index = false;
   bool use_spur_actions = false;
   // Log & data files
   std::string planner_log_file;
@@ -77,6 +103,19 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.p_goal_reached_termination_threshold
       = node->declare_parameter("p_goal_reached_termination_threshold",
                   options.p_goal_reached_termination_threshold);
+  options.p_goal_reached_convergence_threshold
+      = node->declare_parameter("p_goal_reached_convergence_threshold",
+                  options.p_goal_reached_convergence_threshold);
+  options.p_goal_reached_convergence_particle_window
+      = static_cast<uint32_t>(node->declare_parameter(
+          "p_goal_reached_convergence_particle_window",
+          static_cast<int>(
+              options.p_goal_reached_convergence_particle_window)));
+  options.p_goal_reached_convergence_iteration_window
+      = static_cast<uint32_t>(node->declare_parameter(
+          "p_goal_reached_convergence_iteration_window",
+          static_cast<int>(
+              options.p_goal_reached_convergence_iteration_window)));
   options.goal_bias = node->declare_parameter("goal_bias", options.goal_bias);
   options.step_size = node->declare_parameter("step_size", options.step_size);
   options.goal_probability_threshold
@@ -88,6 +127,12 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.connect_after_first_solution
       = node->declare_parameter("connect_after_first_solution",
                                 options.connect_after_first_solution);
+  options.expansion_batch_size
+      = static_cast<uint32_t>(node->declare_parameter("expansion_batch_size",
+                              static_cast<int>(options.expansion_batch_size)));
+  options.repeated_expansion_tolerance
+      = node->declare_parameter("repeated_expansion_tolerance",
+                                options.repeated_expansion_tolerance);
   options.feasibility_alpha
       = node->declare_parameter("feasibility_alpha",
                                 options.feasibility_alpha);
@@ -96,6 +141,11 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.num_particles
       = static_cast<uint32_t>(node->declare_parameter("num_particles",
                               static_cast<int>(options.num_particles)));
+  options.particle_resampling_method
+      = ParticleResamplingMethodFromString(
+          node->declare_parameter("particle_resampling_method",
+                                  ParticleResamplingMethodToString(
+                                      options.particle_resampling_method)));
   options.planner_log_file
       = node->declare_parameter("planner_log_file", options.planner_log_file);
   options.planned_policy_file
@@ -112,6 +162,14 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
       = node->declare_parameter("use_contact", options.use_contact);
   options.use_reverse
       = node->declare_parameter("use_reverse", options.use_reverse);
+  options.use_lazy_reverse
+      = node->declare_parameter("use_lazy_reverse", options.use_lazy_reverse);
+  options.use_concurrent_reverse
+      = node->declare_parameter(
+          "use_concurrent_reverse", options.use_concurrent_reverse);
+  options.use_nearest_neighbors_index
+      = node->declare_parameter(
+          "use_nearest_neighbors_index", options.use_nearest_neighbors_index);
   options.num_policy_simulations
       = static_cast<uint32_t>(
           node->declare_parameter("num_policy_simulations",
@@ -153,6 +211,19 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.p_goal_reached_termination_threshold
       = nhp.param(std::string("p_goal_reached_termination_threshold"),
                   options.p_goal_reached_termination_threshold);
+  options.p_goal_reached_convergence_threshold
+      = nhp.param(std::string("p_goal_reached_convergence_threshold"),
+                  options.p_goal_reached_convergence_threshold);
+  options.p_goal_reached_convergence_particle_window
+      = static_cast<uint32_t>(nhp.param(
+          std::string("p_goal_reached_convergence_particle_window"),
+          static_cast<int>(
+              options.p_goal_reached_convergence_particle_window)));
+  options.p_goal_reached_convergence_iteration_window
+      = static_cast<uint32_t>(nhp.param(
+          std::string("p_goal_reached_convergence_iteration_window"),
+          static_cast<int>(
+              options.p_goal_reached_convergence_iteration_window)));
   options.goal_bias = nhp.param(std::string("goal_bias"), options.goal_bias);
   options.step_size = nhp.param(std::string("step_size"), options.step_size);
   options.goal_probability_threshold
@@ -164,6 +235,12 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.connect_after_first_solution
       = nhp.param(std::string("connect_after_first_solution"),
                   options.connect_after_first_solution);
+  options.expansion_batch_size
+      = static_cast<uint32_t>(nhp.param(std::string("expansion_batch_size"),
+                              static_cast<int>(options.expansion_batch_size)));
+  options.repeated_expansion_tolerance
+      = nhp.param(std::string("repeated_expansion_tolerance"),
+                  options.repeated_expansion_tolerance);
   options.feasibility_alpha
       = nhp.param(std::string("feasibility_alpha"),
                   options.feasibility_alpha);
@@ -172,6 +249,11 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
   options.num_particles
       = static_cast<uint32_t>(nhp.param(std::string("num_particles"),
                               static_cast<int>(options.num_particles)));
+  options.particle_resampling_method
+      = ParticleResamplingMethodFromString(
+          nhp.param(std::string("particle_resampling_method"),
+                    ParticleResamplingMethodToString(
+                        options.particle_resampling_method)));
   options.planner_log_file
       = nhp.param(std::string("planner_log_file"), options.planner_log_file);
   options.planned_policy_file
@@ -187,6 +269,14 @@ inline PLANNING_AND_EXECUTION_OPTIONS GetOptions(
       = nhp.param(std::string("use_contact"), options.use_contact);
   options.use_reverse
       = nhp.param(std::string("use_reverse"), options.use_reverse);
+  options.use_lazy_reverse
+      = nhp.param(std::string("use_lazy_reverse"), options.use_lazy_reverse);
+  options.use_concurrent_reverse
+      = nhp.param(std::string("use_concurrent_reverse"),
+                  options.use_concurrent_reverse);
+  options.use_nearest_neighbors_index
+      = nhp.param(std::string("use_nearest_neighbors_index"),
+                  options.use_nearest_neighbors_index);
   options.num_policy_simulations
       = static_cast<uint32_t>(
           nhp.param(std::string("num_policy_simulations"),
@@ -302,6 +392,28 @@ using VectorXdRobotPtr = std::shared_ptr<VectorXdRobot>;
 using VectorXdSimulator
     = SimpleSimulatorInterface<VectorXdConfig, PRNG, VectorXdConfigAlloc>;
 using VectorXdSimulatorPtr = std::shared_ptr<VectorXdSimulator>;
+using VectorXdSimulationResultCache
+    = SimulationResultCache<VectorXdConfig, VectorXdConfigSerializer>;
+using VectorXdSimulationResultCachePtr
+    = std::shared_ptr<VectorXdSimulationResultCache>;
+using VectorXdCachingSimulator = CachingSimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdConfigAlloc>;
+using VectorXdSimulationRecorder
+    = SimulationRecorder<VectorXdConfig, VectorXdConfigSerializer>;
+using VectorXdSimulationRecorderPtr
+    = std::shared_ptr<VectorXdSimulationRecorder>;
+using VectorXdSimulationRecording
+    = SimulationRecording<VectorXdConfig, VectorXdConfigSerializer>;
+using VectorXdSimulationRecordingPtr
+    = std::shared_ptr<VectorXdSimulationRecording>;
+using VectorXdRecordingSimulator = RecordingSimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdConfigAlloc>;
+using VectorXdReplaySimulator = ReplaySimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdConfigAlloc>;
+using VectorXdParallelParticleSimulator = ParallelParticleSimulator<
+    VectorXdConfig, PRNG, VectorXdConfigAlloc>;
+using VectorXdSimulationResultBatch
+    = SimulationResultBatch<VectorXdConfig, VectorXdConfigAlloc>;
 using VectorXdClustering
     = SimpleOutcomeClusteringInterface<VectorXdConfig, VectorXdConfigAlloc>;
 using VectorXdClusteringPtr = std::shared_ptr<VectorXdClustering>;
@@ -312,11 +424,57 @@ using VectorXdPlanningSpace = UncertaintyPlanningSpace<
 using VectorXdPolicyActionExecutionFunction
     = PolicyActionExecutionFunction<VectorXdConfig, VectorXdConfigAlloc>;
 
+// VectorXd planners whose particle storage comes from the planner's session
+// arena while planning (see SessionArenaAllocator), and from the heap
+// otherwise. Only the particle vectors themselves are allocated from the
+// arena; the coefficients of each Eigen::VectorXd are still allocated with
+// Eigen's aligned malloc.
+using VectorXdArenaConfigAlloc = SessionArenaAllocator<Eigen::VectorXd>;
+using VectorXdArenaConfigVector
+    = std::vector<VectorXdConfig, VectorXdArenaConfigAlloc>;
+using VectorXdArenaPolicy = ExecutionPolicy<
+    VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>;
+using VectorXdArenaPolicyPlanningResult
+    = UncertaintyPolicyPlanningResult<
+        VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>;
+using VectorXdArenaPolicyExecutionResult
+    = UncertaintyPolicyExecutionResult<
+        VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>;
+using VectorXdArenaRobot
+    = common_robotics_utilities::simple_robot_model_interface
+        ::SimpleRobotModelInterface<VectorXdConfig, VectorXdArenaConfigAlloc>;
+using VectorXdArenaRobotPtr = std::shared_ptr<VectorXdArenaRobot>;
+using VectorXdArenaSimulator
+    = SimpleSimulatorInterface<VectorXdConfig, PRNG, VectorXdArenaConfigAlloc>;
+using VectorXdArenaSimulatorPtr = std::shared_ptr<VectorXdArenaSimulator>;
+using VectorXdArenaCachingSimulator = CachingSimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdArenaConfigAlloc>;
+using VectorXdArenaRecordingSimulator = RecordingSimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdArenaConfigAlloc>;
+using VectorXdArenaReplaySimulator = ReplaySimulator<
+    VectorXdConfig, VectorXdConfigSerializer, PRNG, VectorXdArenaConfigAlloc>;
+using VectorXdArenaParallelParticleSimulator = ParallelParticleSimulator<
+    VectorXdConfig, PRNG, VectorXdArenaConfigAlloc>;
+using VectorXdArenaSimulationResultBatch
+    = SimulationResultBatch<VectorXdConfig, VectorXdArenaConfigAlloc>;
+using VectorXdArenaClustering = SimpleOutcomeClusteringInterface<
+    VectorXdConfig, VectorXdArenaConfigAlloc>;
+using VectorXdArenaClusteringPtr = std::shared_ptr<VectorXdArenaClustering>;
+using VectorXdArenaPlanningState = UncertaintyPlanningState<
+    VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>;
+using VectorXdArenaPlanningSpace = UncertaintyPlanningSpace<
+    VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc, PRNG>;
+using VectorXdArenaPolicyActionExecutionFunction
+    = PolicyActionExecutionFunction<VectorXdConfig, VectorXdArenaConfigAlloc>;
+
 // Typedefs for user-provided goal check functions
 
 using VectorXdUserGoalStateCheckFn
     = std::function<double(const VectorXdPlanningState&)>;
 
+using VectorXdArenaUserGoalStateCheckFn
+    = std::function<double(const VectorXdArenaPlanningState&)>;
+
 using VectorXdUserGoalConfigCheckFn
     = std::function<bool(const VectorXdConfig&)>;
 
@@ -561,6 +719,11 @@ bool SaveVectorXdPolicy(
 
 VectorXdPolicy LoadVectorXdPolicy(const std::string& filename);
 
+bool SaveVectorXdPolicy(
+    const VectorXdArenaPolicy& policy, const std::string& filename);
+
+VectorXdArenaPolicy LoadVectorXdArenaPolicy(const std::string& filename);
+
 // VectorXd Interface
 
 VectorXdConfigVector DemonstrateVectorXdSimulator(
@@ -660,6 +823,105 @@ VectorXdPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn);
 
+// VectorXd Interface with session arena particle storage
+
+VectorXdArenaConfigVector DemonstrateVectorXdSimulator(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyPlanningResult PlanVectorXdUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyPlanningResult PlanVectorXdUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdArenaUserGoalStateCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const VectorXdArenaPolicyActionExecutionFunction& robot_execution_fn,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdUserGoalConfigCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
+VectorXdArenaPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdUserGoalConfigCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const VectorXdArenaPolicyActionExecutionFunction& robot_execution_fn,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn);
+
 inline std::ostream& operator<<(
     std::ostream& strm, const PLANNING_AND_EXECUTION_OPTIONS& options)
 {
@@ -667,6 +929,12 @@ inline std::ostream& operator<<(
   strm << "\nplanner_time_limit: " << options.planner_time_limit;
   strm << "\np_goal_reached_termination_threshold: ";
   strm << options.p_goal_reached_termination_threshold;
+  strm << "\np_goal_reached_convergence_threshold: ";
+  strm << options.p_goal_reached_convergence_threshold;
+  strm << "\np_goal_reached_convergence_particle_window: ";
+  strm << options.p_goal_reached_convergence_particle_window;
+  strm << "\np_goal_reached_convergence_iteration_window: ";
+  strm << options.p_goal_reached_convergence_iteration_window;
   strm << "\ngoal_bias: " << options.goal_bias;
   strm << "\nstep_size: " << options.step_size;
   strm << "\ngoal_probability_threshold: ";
@@ -674,12 +942,18 @@ inline std::ostream& operator<<(
   strm << "\ngoal_distance_threshold: " << options.goal_distance_threshold;
   strm << "\nconnect_after_first_solution: ";
   strm << options.connect_after_first_solution;
+  strm << "\nexpansion_batch_size: " << options.expansion_batch_size;
+  strm << "\nrepeated_expansion_tolerance: ";
+  strm << options.repeated_expansion_tolerance;
   strm << "\nfeasibility_alpha: " << options.feasibility_alpha;
   strm << "\nvariance_alpha: " << options.variance_alpha;
   strm << "\nedge_attempt_count: " << options.edge_attempt_count;
   strm << "\npolicy_action_attempt_count: ";
   strm << options.policy_action_attempt_count;
   strm << "\nnum_particles: " << options.num_particles;
+  strm << "\nparticle_resampling_method: ";
+  strm << ParticleResamplingMethodToString(
+      options.particle_resampling_method);
   strm << "\nnum_policy_simulations: " << options.num_policy_simulations;
   strm << "\nnum_policy_executions: " << options.num_policy_executions;
   strm << "\nmax_exec_actions: " << options.max_exec_actions;
@@ -687,6 +961,10 @@ inline std::ostream& operator<<(
   strm << "\ndebug_level: " << options.debug_level;
   strm << "\nuse_contact: " << options.use_contact;
   strm << "\nuse_reverse: " << options.use_reverse;
+  strm << "\nuse_lazy_reverse: " << options.use_lazy_reverse;
+  strm << "\nuse_concurrent_reverse: " << options.use_concurrent_reverse;
+  strm << "\nuse_nearest_neighbors_index: ";
+  strm << options.use_nearest_neighbors_index;
   strm << "\nuse_spur_actions: " << options.use_spur_actions;
   strm << "\nplanner_log_file: " << options.planner_log_file;
   strm << "\npolicy_log_file: " << options.policy_log_file;
@@ -0,0 +1,329 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include <common_robotics_utilities/simple_knearest_neighbors.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Incrementally-built vantage point tree for nearest-neighbor queries over a
+/// collection that only grows (i.e. an RRT planning tree). Items are referred
+/// to by their index in the collection, and all distances are provided by the
+/// caller, so the index never stores or copies the items themselves.
+///
+/// Pruning is only exact if the distance used to build the index is a metric
+/// (in particular, it must satisfy the triangle inequality).
+class VantagePointTree
+{
+public:
+  /// Metric distance between two indexed items.
+  using ItemDistanceFunction
+      = std::function<double(const int64_t, const int64_t)>;
+  /// Metric distance between the query and an indexed item.
+  using QueryDistanceFunction = std::function<double(const int64_t)>;
+  /// Final score of an item, given its metric distance to the query. Return
+  /// infinity to exclude an item from the query.
+  using CandidateDistanceFunction
+      = std::function<double(const int64_t, const double)>;
+
+private:
+  class DistanceBounds
+  {
+  private:
+    double min_;
+    double max_;
+
+  public:
+    DistanceBounds()
+        : min_(std::numeric_limits<double>::infinity()),
+          max_(-std::numeric_limits<double>::infinity()) {}
+
+    void Extend(const double distance)
+    {
+      min_ = std::min(min_, distance);
+      max_ = std::max(max_, distance);
+    }
+
+    /// Lower bound on the distance from a query to any item within the bounds,
+    /// given the distance from the query to the vantage point.
+    double LowerBound(const double query_distance) const
+    {
+      if (min_ > max_)
+      {
+        return std::numeric_limits<double>::infinity();
+      }
+      return std::max(
+          0.0, std::max(min_ - query_distance, query_distance - max_));
+    }
+  };
+
+  class VantagePointTreeNode
+  {
+  private:
+    std::vector<int64_t> items_;
+    size_t split_size_;
+    int64_t vantage_item_;
+    double threshold_;
+    int64_t inner_child_;
+    int64_t outer_child_;
+    DistanceBounds inner_bounds_;
+    DistanceBounds outer_bounds_;
+
+  public:
+    explicit VantagePointTreeNode(const size_t split_size)
+        : split_size_(split_size), vantage_item_(-1), threshold_(0.0),
+          inner_child_(-1), outer_child_(-1) {}
+
+    bool IsLeaf() const { return vantage_item_ < 0; }
+
+    const std::vector<int64_t>& Items() const { return items_; }
+
+    std::vector<int64_t>& MutableItems() { return items_; }
+
+    size_t SplitSize() const { return split_size_; }
+
+    void SetSplitSize(const size_t split_size) { split_size_ = split_size; }
+
+    int64_t VantageItem() const { return vantage_item_; }
+
+    double Threshold() const { return threshold_; }
+
+    int64_t InnerChild() const { return inner_child_; }
+
+    int64_t OuterChild() const { return outer_child_; }
+
+    const DistanceBounds& InnerBounds() const { return inner_bounds_; }
+
+    DistanceBounds& MutableInnerBounds() { return inner_bounds_; }
+
+    const DistanceBounds& OuterBounds() const { return outer_bounds_; }
+
+    DistanceBounds& MutableOuterBounds() { return outer_bounds_; }
+
+    void MakeInternal(
+        const int64_t vantage_item, const double threshold,
+        const int64_t inner_child, const int64_t outer_child)
+    {
+      items_.clear();
+      items_.shrink_to_fit();
+      vantage_item_ = vantage_item;
+      threshold_ = threshold;
+      inner_child_ = inner_child;
+      outer_child_ = outer_child;
+    }
+  };
+
+  std::vector<VantagePointTreeNode> nodes_;
+  size_t leaf_size_;
+  size_t size_;
+
+  void SplitLeaf(
+      const int64_t node_index, const ItemDistanceFunction& item_distance_fn)
+  {
+    const std::vector<int64_t> items
+        = nodes_.at(static_cast<size_t>(node_index)).Items();
+    // Use the item farthest from an arbitrary item as the vantage point, which
+    // tends to pick points on the "edge" of the leaf and gives better splits.
+    size_t vantage_position = 0;
+    double farthest_distance = -1.0;
+    for (size_t idx = 1; idx < items.size(); idx++)
+    {
+      const double distance = item_distance_fn(items.at(0), items.at(idx));
+      if (distance > farthest_distance)
+      {
+        farthest_distance = distance;
+        vantage_position = idx;
+      }
+    }
+    const int64_t vantage_item = items.at(vantage_position);
+    std::vector<std::pair<double, int64_t>> distances;
+    distances.reserve(items.size() - 1);
+    for (size_t idx = 0; idx < items.size(); idx++)
+    {
+      if (idx != vantage_position)
+      {
+        distances.push_back(std::make_pair(
+            item_distance_fn(vantage_item, items.at(idx)), items.at(idx)));
+      }
+    }
+    const size_t median_position = distances.size() / 2;
+    std::nth_element(
+        distances.begin(),
+        distances.begin() + static_cast<std::ptrdiff_t>(median_position),
+        distances.end());
+    const double threshold = distances.at(median_position).first;
+    const bool degenerate_split
+        = std::all_of(distances.begin(), distances.end(),
+                      [&] (const std::pair<double, int64_t>& distance)
+    {
+      return distance.first >= threshold;
+    });
+    if (degenerate_split)
+    {
+      // Every item is equidistant from the vantage point (e.g. many duplicate
+      // states), so splitting would not separate anything. Let the leaf grow.
+      VantagePointTreeNode& leaf = nodes_.at(static_cast<size_t>(node_index));
+      leaf.SetSplitSize(leaf.SplitSize() * 2);
+      return;
+    }
+    VantagePointTreeNode inner_child(leaf_size_);
+    VantagePointTreeNode outer_child(leaf_size_);
+    for (const auto& distance : distances)
+    {
+      if (distance.first < threshold)
+      {
+        inner_child.MutableItems().push_back(distance.second);
+      }
+      else
+      {
+        outer_child.MutableItems().push_back(distance.second);
+      }
+    }
+    const int64_t inner_child_index = static_cast<int64_t>(nodes_.size());
+    const int64_t outer_child_index = inner_child_index + 1;
+    nodes_.push_back(inner_child);
+    nodes_.push_back(outer_child);
+    VantagePointTreeNode& split_node
+        = nodes_.at(static_cast<size_t>(node_index));
+    split_node.MakeInternal(
+        vantage_item, threshold, inner_child_index, outer_child_index);
+    for (const auto& distance : distances)
+    {
+      if (distance.first < threshold)
+      {
+        split_node.MutableInnerBounds().Extend(distance.first);
+      }
+      else
+      {
+        split_node.MutableOuterBounds().Extend(distance.first);
+      }
+    }
+  }
+
+public:
+  explicit VantagePointTree(const size_t leaf_size = 32)
+      : leaf_size_(std::max(leaf_size, static_cast<size_t>(2))), size_(0)
+  {
+    Clear();
+  }
+
+  void Clear()
+  {
+    nodes_.clear();
+    nodes_.push_back(VantagePointTreeNode(leaf_size_));
+    size_ = 0;
+  }
+
+  size_t Size() const { return size_; }
+
+  void Insert(const int64_t item, const ItemDistanceFunction& item_distance_fn)
+  {
+    int64_t current_node_index = 0;
+    while (!nodes_.at(static_cast<size_t>(current_node_index)).IsLeaf())
+    {
+      VantagePointTreeNode& current_node
+          = nodes_.at(static_cast<size_t>(current_node_index));
+      const double distance
+          = item_distance_fn(current_node.VantageItem(), item);
+      if (distance < current_node.Threshold())
+      {
+        current_node.MutableInnerBounds().Extend(distance);
+        current_node_index = current_node.InnerChild();
+      }
+      else
+      {
+        current_node.MutableOuterBounds().Extend(distance);
+        current_node_index = current_node.OuterChild();
+      }
+    }
+    VantagePointTreeNode& leaf
+        = nodes_.at(static_cast<size_t>(current_node_index));
+    leaf.MutableItems().push_back(item);
+    size_++;
+    if (leaf.Items().size() > leaf.SplitSize())
+    {
+      SplitLeaf(current_node_index, item_distance_fn);
+    }
+  }
+
+  /// Find the item with the lowest candidate distance. The candidate distance
+  /// of every item must be at least lower_bound_scale times its metric distance
+  /// to the query, which is what allows subtrees to be pruned. Returns an index
+  /// of -1 if every item is excluded.
+  common_robotics_utilities::simple_knearest_neighbors::IndexAndDistance
+  GetNearestNeighbor(
+      const QueryDistanceFunction& query_distance_fn,
+      const CandidateDistanceFunction& candidate_distance_fn,
+      const double lower_bound_scale) const
+  {
+    using common_robotics_utilities::simple_knearest_neighbors
+        ::IndexAndDistance;
+    IndexAndDistance best;
+    const auto consider_candidate
+        = [&] (const int64_t item, const double distance)
+    {
+      const double candidate_distance = candidate_distance_fn(item, distance);
+      if ((candidate_distance < best.Distance())
+          || ((candidate_distance == best.Distance())
+              && (candidate_distance
+                  < std::numeric_limits<double>::infinity())
+              && (item < best.Index())))
+      {
+        best.SetIndexAndDistance(item, candidate_distance);
+      }
+    };
+    // Explicit stack of (node index, lower bound on metric distance)
+    std::vector<std::pair<int64_t, double>> node_stack;
+    node_stack.push_back(std::make_pair(0, 0.0));
+    while (node_stack.size() > 0)
+    {
+      const int64_t node_index = node_stack.back().first;
+      const double node_lower_bound = node_stack.back().second;
+      node_stack.pop_back();
+      if ((node_lower_bound * lower_bound_scale) > best.Distance())
+      {
+        continue;
+      }
+      const VantagePointTreeNode& node
+          = nodes_.at(static_cast<size_t>(node_index));
+      if (node.IsLeaf())
+      {
+        for (const int64_t item : node.Items())
+        {
+          consider_candidate(item, query_distance_fn(item));
+        }
+      }
+      else
+      {
+        const double vantage_distance = query_distance_fn(node.VantageItem());
+        consider_candidate(node.VantageItem(), vantage_distance);
+        const double inner_lower_bound
+            = node.InnerBounds().LowerBound(vantage_distance);
+        const double outer_lower_bound
+            = node.OuterBounds().LowerBound(vantage_distance);
+        // Push the farther child first, so the closer child is searched first
+        if (vantage_distance < node.Threshold())
+        {
+          node_stack.push_back(
+              std::make_pair(node.OuterChild(), outer_lower_bound));
+          node_stack.push_back(
+              std::make_pair(node.InnerChild(), inner_lower_bound));
+        }
+        else
+        {
+          node_stack.push_back(
+              std::make_pair(node.InnerChild(), inner_lower_bound));
+          node_stack.push_back(
+              std::make_pair(node.OuterChild(), outer_lower_bound));
+        }
+      }
+    }
+    return best;
+  }
+};
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,165 @@
+#pragma once
+
+#include <stdint.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <Eigen/Geometry>
+#include <common_robotics_utilities/utility.hpp>
+
+namespace uncertainty_planning_core
+{
+/// Optional interface for robot models with Eigen::VectorXd configurations
+/// whose ComputeConfigurationDistance() is a per-dimension weighted Euclidean
+/// distance, i.e. distance(a, b) = || weights .* (a - b) ||. Robot models that
+/// also inherit from this interface allow the planner to store expectations in
+/// a dense matrix and compute nearest-neighbor distances in batches, without a
+/// virtual call per pair of configurations.
+class WeightedEuclideanDistanceInterface
+{
+public:
+  virtual ~WeightedEuclideanDistanceInterface() {}
+
+  virtual Eigen::VectorXd GetEuclideanDistanceWeights() const = 0;
+};
+
+/// Dense column-major storage of Eigen::VectorXd configurations (one column per
+/// configuration), with batch weighted Euclidean distance computation.
+class WeightedEuclideanDistanceMatrix
+{
+private:
+  Eigen::MatrixXd configurations_;
+  Eigen::VectorXd squared_weights_;
+  size_t size_;
+
+public:
+  WeightedEuclideanDistanceMatrix() : size_(0) {}
+
+  explicit WeightedEuclideanDistanceMatrix(const Eigen::VectorXd& weights)
+      : squared_weights_(weights.cwiseProduct(weights)), size_(0) {}
+
+  bool IsValid() const { return squared_weights_.size() > 0; }
+
+  void Clear() { size_ = 0; }
+
+  size_t Size() const { return size_; }
+
+  void AddConfiguration(const Eigen::VectorXd& configuration)
+  {
+    if (configuration.size() != squared_weights_.size())
+    {
+      throw std::invalid_argument(
+          "configuration.size() != number of distance weights");
+    }
+    const int64_t num_columns = static_cast<int64_t>(configurations_.cols());
+    if (static_cast<int64_t>(size_) == num_columns)
+    {
+      // Grow geometrically, so insertion is amortized O(1)
+      const int64_t new_num_columns
+          = std::max(num_columns * 2, static_cast<int64_t>(64));
+      configurations_.conservativeResize(
+          squared_weights_.size(), static_cast<ptrdiff_t>(new_num_columns));
+    }
+    configurations_.col(static_cast<ptrdiff_t>(size_)) = configuration;
+    size_++;
+  }
+
+  double ComputeDistance(const int64_t index, const Eigen::VectorXd& query)
+      const
+  {
+    return std::sqrt(
+        ((configurations_.col(static_cast<ptrdiff_t>(index)) - query)
+            .array().square() * squared_weights_.array()).sum());
+  }
+
+  double ComputeDistance(const int64_t first_index, const int64_t second_index)
+      const
+  {
+    return std::sqrt(
+        ((configurations_.col(static_cast<ptrdiff_t>(first_index))
+              - configurations_.col(static_cast<ptrdiff_t>(second_index)))
+            .array().square() * squared_weights_.array()).sum());
+  }
+
+  /// Compute the distance from query to every stored configuration at once.
+  void ComputeDistances(
+      const Eigen::VectorXd& query, Eigen::VectorXd& distances) const
+  {
+    const auto stored_configurations
+        = configurations_.leftCols(static_cast<ptrdiff_t>(size_));
+    distances
+        = ((stored_configurations.colwise() - query).array().square()
+              .colwise() * squared_weights_.array())
+            .colwise().sum().sqrt().transpose();
+  }
+};
+
+/// Only Eigen::VectorXd configurations can be stored in a
+/// WeightedEuclideanDistanceMatrix.
+template<typename Configuration>
+struct SupportsWeightedEuclideanDistance : std::false_type {};
+
+template<>
+struct SupportsWeightedEuclideanDistance<Eigen::VectorXd> : std::true_type {};
+
+/// Overloads to store a configuration in a WeightedEuclideanDistanceMatrix,
+/// which only support Eigen::VectorXd configurations.
+inline void AddDenseConfiguration(
+    const Eigen::VectorXd& configuration,
+    WeightedEuclideanDistanceMatrix& matrix)
+{
+  matrix.AddConfiguration(configuration);
+}
+
+template<typename Configuration>
+inline void AddDenseConfiguration(
+    const Configuration& configuration,
+    WeightedEuclideanDistanceMatrix& matrix)
+{
+  UNUSED(configuration);
+  UNUSED(matrix);
+  throw std::invalid_argument(
+      "Dense distances require Eigen::VectorXd configurations");
+}
+
+/// Overloads to compute distances with a WeightedEuclideanDistanceMatrix, which
+/// only support Eigen::VectorXd configurations.
+inline double ComputeDenseDistance(
+    const WeightedEuclideanDistanceMatrix& matrix, const int64_t index,
+    const Eigen::VectorXd& query)
+{
+  return matrix.ComputeDistance(index, query);
+}
+
+template<typename Configuration>
+inline double ComputeDenseDistance(
+    const WeightedEuclideanDistanceMatrix& matrix, const int64_t index,
+    const Configuration& query)
+{
+  UNUSED(matrix);
+  UNUSED(index);
+  UNUSED(query);
+  throw std::invalid_argument(
+      "Dense distances require Eigen::VectorXd configurations");
+}
+
+inline void ComputeDenseDistances(
+    const WeightedEuclideanDistanceMatrix& matrix,
+    const Eigen::VectorXd& query, Eigen::VectorXd& distances)
+{
+  matrix.ComputeDistances(query, distances);
+}
+
+template<typename Configuration>
+inline void ComputeDenseDistances(
+    const WeightedEuclideanDistanceMatrix& matrix,
+    const Configuration& query, Eigen::VectorXd& distances)
+{
+  UNUSED(matrix);
+  UNUSED(query);
+  UNUSED(distances);
+  throw std::invalid_argument(
+      "Dense distances require Eigen::VectorXd configurations");
+}
+}  // namespace uncertainty_planning_core
@@ -0,0 +1,121 @@
+#include <stdint.h>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <Eigen/Geometry>
+#include <uncertainty_planning_core/uncertainty_planning_core.hpp>
+
+using uncertainty_planning_core::ParticleResamplingMethod;
+using uncertainty_planning_core::PRNG;
+using uncertainty_planning_core::VectorXdConfig;
+using uncertainty_planning_core::VectorXdConfigVector;
+using uncertainty_planning_core::VectorXdPlanningState;
+
+// The rejection loop ResampleParticles() used before the resampling methods
+// were added, kept here as the baseline.
+VectorXdConfigVector RejectionResampleParticles(
+    const VectorXdConfigVector& particles, const size_t num_particles,
+    PRNG& rng)
+{
+  VectorXdConfigVector resampled_particles(num_particles);
+  const double particle_probability
+      = 1.0 / static_cast<double>(particles.size());
+  std::uniform_int_distribution<size_t> resampling_distribution(
+      0, particles.size() - 1);
+  std::uniform_real_distribution<double> importance_sampling_distribution(
+      0.0, 1.0);
+  size_t resampled = 0;
+  while (resampled < num_particles)
+  {
+    const size_t random_index = resampling_distribution(rng);
+    if (importance_sampling_distribution(rng) < particle_probability)
+    {
+      resampled_particles[resampled] = particles[random_index];
+      resampled++;
+    }
+  }
+  return resampled_particles;
+}
+
+// Average time per call of resample_fn, in microseconds. The sum of the
+// resampled particles is accumulated into checksum, so that the calls cannot
+// be optimized away.
+double TimeResampling(
+    const std::function<VectorXdConfigVector(PRNG&)>& resample_fn,
+    const int32_t num_calls, double& checksum)
+{
+  PRNG rng(42);
+  const auto start = std::chrono::steady_clock::now();
+  for (int32_t call = 0; call < num_calls; call++)
+  {
+    const VectorXdConfigVector resampled_particles = resample_fn(rng);
+    checksum += resampled_particles.back().sum();
+  }
+  const auto end = std::chrono::steady_clock::now();
+  const std::chrono::duration<double, std::micro> elapsed = end - start;
+  return elapsed.count() / static_cast<double>(num_calls);
+}
+
+int main(int argc, char** argv)
+{
+  const int32_t num_calls = (argc > 1) ? std::stoi(argv[1]) : 20;
+  const Eigen::Index num_dimensions = 7;
+  const std::vector<size_t> particle_counts = {500, 1000, 2000};
+  const std::vector<ParticleResamplingMethod> methods = {
+      ParticleResamplingMethod::MULTINOMIAL,
+      ParticleResamplingMethod::SYSTEMATIC,
+      ParticleResamplingMethod::STRATIFIED,
+      ParticleResamplingMethod::RESIDUAL};
+  std::cout << "Resampling N " << num_dimensions << "-DOF particles into N, "
+            << "microseconds per call (average of " << num_calls
+            << " calls)" << std::endl;
+  std::cout << std::setw(6) << "N" << std::setw(12) << "rejection";
+  for (const ParticleResamplingMethod method : methods)
+  {
+    std::cout << std::setw(12)
+              << uncertainty_planning_core::ParticleResamplingMethodToString(
+                  method);
+  }
+  std::cout << std::endl;
+  double checksum = 0.0;
+  for (const size_t num_particles : particle_counts)
+  {
+    PRNG particle_rng(7);
+    std::normal_distribution<double> particle_distribution(0.0, 1.0);
+    VectorXdConfigVector particles;
+    particles.reserve(num_particles);
+    for (size_t idx = 0; idx < num_particles; idx++)
+    {
+      VectorXdConfig particle(num_dimensions);
+      for (Eigen::Index dim = 0; dim < num_dimensions; dim++)
+      {
+        particle(dim) = particle_distribution(particle_rng);
+      }
+      particles.push_back(particle);
+    }
+    const VectorXdPlanningState state(
+        1u, particles, 1u, 1u, 1.0, 1u, 1u, 1.0, 1.0, particles.front(), 1u,
+        2u, 0u, true);
+    std::cout << std::setw(6) << num_particles;
+    std::cout << std::setw(12) << std::fixed << std::setprecision(1)
+              << TimeResampling([&] (PRNG& rng)
+    {
+      return RejectionResampleParticles(particles, num_particles, rng);
+    }, num_calls, checksum);
+    for (const ParticleResamplingMethod method : methods)
+    {
+      std::cout << std::setw(12)
+                << TimeResampling([&] (PRNG& rng)
+      {
+        return state.ResampleParticles(num_particles, rng, method);
+      }, num_calls, checksum);
+    }
+    std::cout << std::endl;
+  }
+  std::cout << "(checksum " << checksum << ")" << std::endl;
+  return 0;
+}
@@ -21,6 +21,231 @@
 
 namespace uncertainty_planning_core
 {
+namespace
+{
+// The VectorXd interface is implemented once for each particle storage
+// allocator, i.e. VectorXdConfigAlloc and VectorXdArenaConfigAlloc.
+
+template<typename ConfigAlloc>
+using VectorXdConfigVectorFor = std::vector<VectorXdConfig, ConfigAlloc>;
+
+template<typename ConfigAlloc>
+using VectorXdPolicyFor
+    = ExecutionPolicy<VectorXdConfig, VectorXdConfigSerializer, ConfigAlloc>;
+
+template<typename ConfigAlloc>
+using VectorXdPolicyPlanningResultFor = UncertaintyPolicyPlanningResult<
+    VectorXdConfig, VectorXdConfigSerializer, ConfigAlloc>;
+
+template<typename ConfigAlloc>
+using VectorXdPolicyExecutionResultFor = UncertaintyPolicyExecutionResult<
+    VectorXdConfig, VectorXdConfigSerializer, ConfigAlloc>;
+
+template<typename ConfigAlloc>
+using VectorXdRobotPtrFor = std::shared_ptr<
+    common_robotics_utilities::simple_robot_model_interface
+        ::SimpleRobotModelInterface<VectorXdConfig, ConfigAlloc>>;
+
+template<typename ConfigAlloc>
+using VectorXdSimulatorPtrFor = std::shared_ptr<
+    SimpleSimulatorInterface<VectorXdConfig, PRNG, ConfigAlloc>>;
+
+template<typename ConfigAlloc>
+using VectorXdClusteringPtrFor = std::shared_ptr<
+    SimpleOutcomeClusteringInterface<VectorXdConfig, ConfigAlloc>>;
+
+template<typename ConfigAlloc>
+using VectorXdUserGoalStateCheckFnFor
+    = std::function<double(const UncertaintyPlanningState<
+        VectorXdConfig, VectorXdConfigSerializer, ConfigAlloc>&)>;
+
+template<typename ConfigAlloc>
+using VectorXdPolicyActionExecutionFunctionFor
+    = PolicyActionExecutionFunction<VectorXdConfig, ConfigAlloc>;
+
+template<typename ConfigAlloc>
+using VectorXdPlanningSpaceFor = UncertaintyPlanningSpace<
+    VectorXdConfig, VectorXdConfigSerializer, ConfigAlloc, PRNG>;
+
+template<typename ConfigAlloc>
+void ConfigureVectorXdPlanning(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    VectorXdPlanningSpaceFor<ConfigAlloc>& planning_space)
+{
+  planning_space.SetExpansionBatchSize(options.expansion_batch_size);
+  if (options.repeated_expansion_tolerance >= 0.0)
+  {
+    planning_space.EnableRepeatedExpansionSkipping(
+        options.repeated_expansion_tolerance);
+  }
+  if (options.use_lazy_reverse)
+  {
+    planning_space.EnableLazyReverseEdgeEvaluation();
+  }
+  if (options.use_concurrent_reverse)
+  {
+    planning_space.EnableConcurrentReverseEdgeChecks();
+  }
+  if (options.use_nearest_neighbors_index)
+  {
+    planning_space.EnableNearestNeighborsIndex();
+  }
+  planning_space.SetConvergenceTermination(
+      options.p_goal_reached_convergence_threshold,
+      options.p_goal_reached_convergence_particle_window,
+      options.p_goal_reached_convergence_iteration_window);
+}
+
+template<typename ConfigAlloc>
+VectorXdConfigVectorFor<ConfigAlloc> DemonstrateSimulator(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdRobotPtrFor<ConfigAlloc>& robot,
+    const VectorXdSimulatorPtrFor<ConfigAlloc>& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdClusteringPtrFor<ConfigAlloc>& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  VectorXdPlanningSpaceFor<ConfigAlloc> planning_space(
+      options.debug_level, options.num_particles, options.step_size,
+      options.goal_distance_threshold, options.goal_probability_threshold,
+      options.feasibility_alpha, options.variance_alpha,
+      options.connect_after_first_solution, robot, sampler, simulator,
+      clustering, logging_fn, options.particle_resampling_method);
+  const auto trace
+      = planning_space.DemonstrateSimulator(start, goal, display_fn);
+  return ExtractTrajectoryFromTrace(trace);
+}
+
+template<typename ConfigAlloc>
+VectorXdPolicyPlanningResultFor<ConfigAlloc> PlanUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdRobotPtrFor<ConfigAlloc>& robot,
+    const VectorXdSimulatorPtrFor<ConfigAlloc>& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdClusteringPtrFor<ConfigAlloc>& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  VectorXdPlanningSpaceFor<ConfigAlloc> planning_space(
+      options.debug_level, options.num_particles, options.step_size,
+      options.goal_distance_threshold, options.goal_probability_threshold,
+      options.feasibility_alpha, options.variance_alpha,
+      options.connect_after_first_solution, robot, sampler, simulator,
+      clustering, logging_fn, options.particle_resampling_method);
+  ConfigureVectorXdPlanning<ConfigAlloc>(options, planning_space);
+  const std::chrono::duration<double> planner_time_limit(
+      options.planner_time_limit);
+  return planning_space.PlanGoalState(
+      start, goal, options.goal_bias, planner_time_limit,
+      options.edge_attempt_count, options.policy_action_attempt_count,
+      options.use_contact, options.use_reverse, options.use_spur_actions,
+      policy_marker_size, options.p_goal_reached_termination_threshold,
+      display_fn);
+}
+
+template<typename ConfigAlloc>
+VectorXdPolicyPlanningResultFor<ConfigAlloc> PlanUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdRobotPtrFor<ConfigAlloc>& robot,
+    const VectorXdSimulatorPtrFor<ConfigAlloc>& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdClusteringPtrFor<ConfigAlloc>& clustering,
+    const VectorXdConfig& start,
+    const VectorXdUserGoalStateCheckFnFor<ConfigAlloc>& user_goal_check_fn,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  VectorXdPlanningSpaceFor<ConfigAlloc> planning_space(
+      options.debug_level, options.num_particles, options.step_size,
+      options.goal_distance_threshold, options.goal_probability_threshold,
+      options.feasibility_alpha, options.variance_alpha,
+      options.connect_after_first_solution, robot, sampler, simulator,
+      clustering, logging_fn, options.particle_resampling_method);
+  ConfigureVectorXdPlanning<ConfigAlloc>(options, planning_space);
+  const std::chrono::duration<double> planner_time_limit(
+      options.planner_time_limit);
+  return planning_space.PlanGoalSampling(
+      start, options.goal_bias, user_goal_check_fn, planner_time_limit,
+      options.edge_attempt_count, options.policy_action_attempt_count,
+      options.use_contact, options.use_reverse, options.use_spur_actions,
+      policy_marker_size, options.p_goal_reached_termination_threshold,
+      display_fn);
+}
+
+template<typename ConfigAlloc, typename Goal>
+VectorXdPolicyExecutionResultFor<ConfigAlloc> SimulateUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdRobotPtrFor<ConfigAlloc>& robot,
+    const VectorXdSimulatorPtrFor<ConfigAlloc>& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdClusteringPtrFor<ConfigAlloc>& clustering,
+    const VectorXdPolicyFor<ConfigAlloc>& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const Goal& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  VectorXdPolicyFor<ConfigAlloc> working_policy = policy;
+  VectorXdPlanningSpaceFor<ConfigAlloc> planning_space(
+      options.debug_level, options.num_particles, options.step_size,
+      options.goal_distance_threshold, options.goal_probability_threshold,
+      options.feasibility_alpha, options.variance_alpha,
+      options.connect_after_first_solution, robot, sampler, simulator,
+      clustering, logging_fn, options.particle_resampling_method);
+  working_policy.SetPolicyActionAttemptCount(
+      options.policy_action_attempt_count);
+  return planning_space.SimulateExectionPolicy(
+      working_policy, allow_branch_jumping,
+      link_runtime_states_to_planned_parent, start, goal,
+      options.num_policy_simulations, options.max_exec_actions, display_fn,
+      policy_marker_size, true, 0.001);
+}
+
+template<typename ConfigAlloc, typename Goal>
+VectorXdPolicyExecutionResultFor<ConfigAlloc> ExecuteUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdRobotPtrFor<ConfigAlloc>& robot,
+    const VectorXdSimulatorPtrFor<ConfigAlloc>& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdClusteringPtrFor<ConfigAlloc>& clustering,
+    const VectorXdPolicyFor<ConfigAlloc>& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const Goal& goal,
+    const double policy_marker_size,
+    const VectorXdPolicyActionExecutionFunctionFor<ConfigAlloc>&
+        robot_execution_fn,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  VectorXdPolicyFor<ConfigAlloc> working_policy = policy;
+  VectorXdPlanningSpaceFor<ConfigAlloc> planning_space(
+      options.debug_level, options.num_particles, options.step_size,
+      options.goal_distance_threshold, options.goal_probability_threshold,
+      options.feasibility_alpha, options.variance_alpha,
+      options.connect_after_first_solution, robot, sampler, simulator,
+      clustering, logging_fn, options.particle_resampling_method);
+  working_policy.SetPolicyActionAttemptCount(
+      options.policy_action_attempt_count);
+  return planning_space.ExecuteExectionPolicy(
+      working_policy, allow_branch_jumping,
+      link_runtime_states_to_planned_parent, start, goal, robot_execution_fn,
+      options.num_policy_executions, options.max_policy_exec_time, display_fn,
+      policy_marker_size, false, 0.001);
+}
+}  // namespace
+
 bool SaveVectorXdPolicy(
     const VectorXdPolicy& policy, const std::string& filename)
 {
@@ -35,6 +260,21 @@ VectorXdPolicy LoadVectorXdPolicy(const std::string& filename)
       VectorXdConfig, VectorXdConfigSerializer, VectorXdConfigAlloc>(filename);
 }
 
+bool SaveVectorXdPolicy(
+    const VectorXdArenaPolicy& policy, const std::string& filename)
+{
+  return SavePolicy<
+      VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>(
+          policy, filename);
+}
+
+VectorXdArenaPolicy LoadVectorXdArenaPolicy(const std::string& filename)
+{
+  return LoadPolicy<
+      VectorXdConfig, VectorXdConfigSerializer, VectorXdArenaConfigAlloc>(
+          filename);
+}
+
 inline double VectorXdUserGoalCheckWrapperFn(
     const VectorXdPlanningState& state,
     const VectorXdUserGoalConfigCheckFn& user_goal_config_check_fn)
@@ -57,15 +297,9 @@ VectorXdConfigVector DemonstrateVectorXdSimulator(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-  VectorXdPlanningSpace planning_space(
-      options.debug_level, options.num_particles, options.step_size,
-      options.goal_distance_threshold, options.goal_probability_threshold,
-      options.feasibility_alpha, options.variance_alpha,
-      options.connect_after_first_solution, robot, sampler, simulator,
-      clustering, logging_fn);
-  const auto trace
-      = planning_space.DemonstrateSimulator(start, goal, display_fn);
-  return ExtractTrajectoryFromTrace(trace);
+  return DemonstrateSimulator<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start, goal, logging_fn,
+      display_fn);
 }
 
 VectorXdPolicyPlanningResult PlanVectorXdUncertainty(
@@ -80,20 +314,9 @@ VectorXdPolicyPlanningResult PlanVectorXdUncertainty(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    const std::chrono::duration<double> planner_time_limit(
-        options.planner_time_limit);
-    return planning_space.PlanGoalState(
-        start, goal, options.goal_bias, planner_time_limit,
-        options.edge_attempt_count, options.policy_action_attempt_count,
-        options.use_contact, options.use_reverse, options.use_spur_actions,
-        policy_marker_size, options.p_goal_reached_termination_threshold,
-        display_fn);
+  return PlanUncertainty<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start, goal,
+      policy_marker_size, logging_fn, display_fn);
 }
 
 VectorXdPolicyPlanningResult PlanVectorXdUncertainty(
@@ -108,20 +331,9 @@ VectorXdPolicyPlanningResult PlanVectorXdUncertainty(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    const std::chrono::duration<double> planner_time_limit(
-        options.planner_time_limit);
-    return planning_space.PlanGoalSampling(
-        start, options.goal_bias, user_goal_check_fn, planner_time_limit,
-        options.edge_attempt_count, options.policy_action_attempt_count,
-        options.use_contact, options.use_reverse, options.use_spur_actions,
-        policy_marker_size, options.p_goal_reached_termination_threshold,
-        display_fn);
+  return PlanUncertainty<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start,
+      user_goal_check_fn, policy_marker_size, logging_fn, display_fn);
 }
 
 VectorXdPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
@@ -139,20 +351,10 @@ VectorXdPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPolicy working_policy = policy;
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    working_policy.SetPolicyActionAttemptCount(
-        options.policy_action_attempt_count);
-    return planning_space.SimulateExectionPolicy(
-        working_policy, allow_branch_jumping,
-        link_runtime_states_to_planned_parent, start, goal,
-        options.num_policy_simulations, options.max_exec_actions, display_fn,
-        policy_marker_size, true, 0.001);
+  return SimulateUncertaintyPolicy<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start, goal,
+      policy_marker_size, logging_fn, display_fn);
 }
 
 VectorXdPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
@@ -171,20 +373,10 @@ VectorXdPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPolicy working_policy = policy;
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    working_policy.SetPolicyActionAttemptCount(
-        options.policy_action_attempt_count);
-    return planning_space.ExecuteExectionPolicy(
-        working_policy, allow_branch_jumping,
-        link_runtime_states_to_planned_parent, start, goal, robot_execution_fn,
-        options.num_policy_executions, options.max_policy_exec_time, display_fn,
-        policy_marker_size, false, 0.001);
+  return ExecuteUncertaintyPolicy<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start, goal,
+      policy_marker_size, robot_execution_fn, logging_fn, display_fn);
 }
 
 VectorXdPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
@@ -202,20 +394,10 @@ VectorXdPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPolicy working_policy = policy;
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    working_policy.SetPolicyActionAttemptCount(
-        options.policy_action_attempt_count);
-    return planning_space.SimulateExectionPolicy(
-        working_policy, allow_branch_jumping,
-        link_runtime_states_to_planned_parent, start, user_goal_check_fn,
-        options.num_policy_simulations, options.max_exec_actions, display_fn,
-        policy_marker_size, true, 0.001);
+  return SimulateUncertaintyPolicy<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start,
+      user_goal_check_fn, policy_marker_size, logging_fn, display_fn);
 }
 
 VectorXdPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
@@ -234,20 +416,149 @@ VectorXdPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
     const LoggingFunction& logging_fn,
     const DisplayFunction& display_fn)
 {
-    VectorXdPolicy working_policy = policy;
-    VectorXdPlanningSpace planning_space(
-        options.debug_level, options.num_particles, options.step_size,
-        options.goal_distance_threshold, options.goal_probability_threshold,
-        options.feasibility_alpha, options.variance_alpha,
-        options.connect_after_first_solution, robot, sampler, simulator,
-        clustering, logging_fn);
-    working_policy.SetPolicyActionAttemptCount(
-        options.policy_action_attempt_count);
-    return planning_space.ExecuteExectionPolicy(
-        working_policy, allow_branch_jumping,
-        link_runtime_states_to_planned_parent, start, user_goal_check_fn,
-        robot_execution_fn, options.num_policy_executions,
-        options.max_policy_exec_time, display_fn, policy_marker_size, false,
-        0.001);
+  return ExecuteUncertaintyPolicy<VectorXdConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start,
+      user_goal_check_fn, policy_marker_size, robot_execution_fn, logging_fn,
+      display_fn);
+}
+
+// VectorXd Interface with session arena particle storage
+
+VectorXdArenaConfigVector DemonstrateVectorXdSimulator(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return DemonstrateSimulator<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start, goal, logging_fn,
+      display_fn);
+}
+
+VectorXdArenaPolicyPlanningResult PlanVectorXdUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return PlanUncertainty<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start, goal,
+      policy_marker_size, logging_fn, display_fn);
+}
+
+VectorXdArenaPolicyPlanningResult PlanVectorXdUncertainty(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdConfig& start,
+    const VectorXdArenaUserGoalStateCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return PlanUncertainty<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, start,
+      user_goal_check_fn, policy_marker_size, logging_fn, display_fn);
+}
+
+VectorXdArenaPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return SimulateUncertaintyPolicy<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start, goal,
+      policy_marker_size, logging_fn, display_fn);
+}
+
+VectorXdArenaPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdConfig& goal,
+    const double policy_marker_size,
+    const VectorXdArenaPolicyActionExecutionFunction& robot_execution_fn,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return ExecuteUncertaintyPolicy<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start, goal,
+      policy_marker_size, robot_execution_fn, logging_fn, display_fn);
+}
+
+VectorXdArenaPolicyExecutionResult SimulateVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdUserGoalConfigCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return SimulateUncertaintyPolicy<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start,
+      user_goal_check_fn, policy_marker_size, logging_fn, display_fn);
+}
+
+VectorXdArenaPolicyExecutionResult ExecuteVectorXdUncertaintyPolicy(
+    const PLANNING_AND_EXECUTION_OPTIONS& options,
+    const VectorXdArenaRobotPtr& robot,
+    const VectorXdArenaSimulatorPtr& simulator,
+    const VectorXdSamplerPtr& sampler,
+    const VectorXdArenaClusteringPtr& clustering,
+    const VectorXdArenaPolicy& policy,
+    const bool allow_branch_jumping,
+    const bool link_runtime_states_to_planned_parent,
+    const VectorXdConfig& start,
+    const VectorXdUserGoalConfigCheckFn& user_goal_check_fn,
+    const double policy_marker_size,
+    const VectorXdArenaPolicyActionExecutionFunction& robot_execution_fn,
+    const LoggingFunction& logging_fn,
+    const DisplayFunction& display_fn)
+{
+  return ExecuteUncertaintyPolicy<VectorXdArenaConfigAlloc>(
+      options, robot, simulator, sampler, clustering, policy,
+      allow_branch_jumping, link_runtime_states_to_planned_parent, start,
+      user_goal_check_fn, policy_marker_size, robot_execution_fn, logging_fn,
+      display_fn);
 }
 }  // namespace uncertainty_planning_core